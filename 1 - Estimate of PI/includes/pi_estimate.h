@@ -0,0 +1,25 @@
+#ifndef PI_ESTIMATE_H
+#define PI_ESTIMATE_H
+
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include <monte_carlo_integration.h>
+
+struct PiEstimate {
+	PiEstimate() = default;
+	explicit PiEstimate(std::string sequence, IntegrationEstimate estimate, double seconds);
+
+	friend std::ostream & operator<<(std::ostream & os, const PiEstimate & measurement) {
+		std::stringstream output;
+		output << measurement.sequence << "," << measurement.samples << "," << measurement.pi << "," << measurement.uncertainty << "," << measurement.error << "," << measurement.samples_per_second;
+		return os << output.str();
+	}
+
+	std::string sequence;
+	std::size_t samples;
+	double pi, uncertainty, error, samples_per_second;
+};
+
+#endif //PI_ESTIMATE_H
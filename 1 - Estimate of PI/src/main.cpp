@@ -0,0 +1,81 @@
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <iostream>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <monte_carlo_integration.h>
+#include <pi_estimate.h>
+#include <trace.h>
+#include <utils.h>
+
+/**
+ * The smallest and largest number of samples are 2^MIN_EXPONENT and 2^MAX_EXPONENT.
+ */
+constexpr size_t MIN_EXPONENT = 10;
+
+constexpr size_t MAX_EXPONENT = 26;
+
+/**
+ * The seed of the pseudo-random numbers.
+ */
+constexpr uint64_t SEED = 42;
+
+/**
+ * The sample sequences which are compared together with their names in the output.
+ */
+const std::vector<std::pair<SampleSequence, std::string>> SEQUENCES {
+	{ SampleSequence::Pseudo, "pseudo" },
+	{ SampleSequence::Halton, "halton" },
+	{ SampleSequence::Sobol, "sobol" }
+};
+
+/**
+ * Estimates pi as four times the fraction of points in the unit square which fall into the quarter circle and
+ * measures how many samples are processed per second.
+ *
+ * @param sequence The sequence from which the sample points are drawn.
+ * @param name The name of the sequence in the output.
+ * @param num_samples The number of sample points.
+ * @return The estimate of pi, its error and the throughput.
+ */
+PiEstimate estimate_pi(const SampleSequence sequence, const std::string & name, const size_t num_samples) {
+	const TraceSpan span { "estimate_pi", { { "samples", num_samples } } };
+	const MonteCarloIntegrator integrator { sequence, SEED };
+
+	const auto begin = std::chrono::steady_clock::now();
+	const IntegrationEstimate estimate = integrator.integrate(MonteCarloIntegrator::quarter_circle, num_samples);
+	const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - begin;
+
+	return PiEstimate { name, estimate, seconds.count() };
+}
+
+/**
+ * Estimates pi with increasing numbers of samples for every sequence and writes the errors and throughputs to a CSV
+ * file.
+ */
+void measure_convergence() {
+	std::vector<PiEstimate> measurements;
+	for (const auto & [sequence, name] : SEQUENCES) {
+		for (size_t exponent = MIN_EXPONENT; exponent <= MAX_EXPONENT; ++exponent) {
+			std::cout << "\rEstimating PI with " << name << " samples: 2^" << exponent << std::flush;
+			measurements.push_back(estimate_pi(sequence, name, static_cast<size_t>(1) << exponent));
+		}
+		std::cout << std::endl;
+
+		const PiEstimate & largest = measurements.back();
+		std::cout << "\tPI = " << largest.pi << " +/- " << largest.uncertainty << ", error " << largest.error << ", " << largest.samples_per_second << " samples/s" << std::endl;
+	}
+
+	const std::span<const PiEstimate> span = measurements;
+	write_output_csv(span, "pi_convergence", "sequence,samples,pi,uncertainty,error,samples_per_second");
+}
+
+int main() {
+	std::filesystem::create_directory("output");
+	TraceSpan::enable("trace");
+	measure_convergence();
+}
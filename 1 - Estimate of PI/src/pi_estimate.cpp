@@ -0,0 +1,9 @@
+#include "pi_estimate.h"
+
+#include <cmath>
+#include <numbers>
+
+PiEstimate::PiEstimate(std::string sequence, const IntegrationEstimate estimate, const double seconds)
+	: sequence(std::move(sequence)), samples(estimate.samples), pi(4.0 * estimate.mean), uncertainty(4.0 * estimate.uncertainty),
+	  error(std::abs(pi - std::numbers::pi)), samples_per_second(static_cast<double>(estimate.samples) / seconds)
+{ }
@@ -5,21 +5,11 @@
 #include <fstream>
 #include <iostream>
 #include <numeric>
-#include <random>
 #include <ranges>
 #include <string>
 #include <execution>
 #include "histogram.h"
-
-/**
- * The Mersenne Twister 19937 uniform random number generator with random seed.
- */
-static thread_local std::mt19937 generator {std::random_device()()};
-
-/**
- * A uniform distribution [0, 1] from which the generate can sample.
- */
-static std::uniform_int_distribution uniform_distribution {0, 1};
+#include "random_buffer.h"
 
 /**
  * The iterator on the integer interval [0, 32) used for the number of coinflips
@@ -58,13 +48,15 @@ std::vector<std::size_t> sequence() {
 /**
  * Generates a uniform random real number on the interval [0, 1) by flipping a coin 32 times.
  * The results of this flip are accumulated according to $real = \sum^{32}_{j=1}{\frac{f_j}{2^{j}}}$.
+ * The coins are the bits of a single raw random number.
  *
  * @return A uniform random real number on the interval [0, 1)
  */
 double uniform_real()
 {
+    const uint64_t coins = RandomBuffer::local().next();
     return std::accumulate(flips.begin(), flips.end(), 0.0, [&] (const double acc, const int j) {
-        return acc + uniform_distribution(generator) / pow(2, j + 1);
+        return acc + static_cast<double>((coins >> j) & 1) / pow(2, j + 1);
     });
 }
 
@@ -91,19 +83,21 @@ void sequence_of_uniform_reals()
  * Generates a biased random real number on the interval [0, 1) by flipping a coin 32 times.
  * The results of this flip are accumulated according to $real = \sum^{32}_{j=1}{\frac{f_j}{2^{j}}}$.
  *
- * @param distributions The array of biased distributions. Has the same length as the number of coinflips used.
+ * @param thresholds The integer thresholds of the biased coins. Has the same length as the number of coinflips used.
  * @return A biased random real number on the interval [0, 1)
  */
-double biased_real(std::array<std::discrete_distribution<>, 32> & distributions)
+double biased_real(const std::array<uint64_t, 32> & thresholds)
 {
+    RandomBuffer & random = RandomBuffer::local();
     return std::accumulate(flips.begin(), flips.end(), 0.0, [&] (const double acc, const int j) {
-        return acc + distributions.at(j)(generator) / pow(2, j + 1);
+        return acc + random.accept(thresholds.at(j)) / pow(2, j + 1);
     });
 }
 
 /**
- * Generates a sequence of biased reals in parallel and writes the result to a CSV file. The biased distributions are
- * calculated once for evey possible value of j and then passed to the function calculating the biased real number.
+ * Generates a sequence of biased reals in parallel and writes the result to a CSV file. The thresholds of the biased
+ * coins are calculated once for evey possible value of j and then passed to the function calculating the biased real
+ * number.
  *
  * @tparam S The size of the sequence of biased reals.
  * @param lambda The lambda parameter of the bias.
@@ -114,15 +108,15 @@ void sequence_of_biased_reals(const double lambda)
     std::cout << "\t Lambda is " << lambda << std::endl;
     histogram::Histogram histogram { 100 };
 
-    std::array<std::discrete_distribution<>, 32> distributions {};
-    std::transform(flips.begin(), flips.end(), distributions.begin(), [=] (const int j) {
+    std::array<uint64_t, 32> thresholds {};
+    std::transform(flips.begin(), flips.end(), thresholds.begin(), [=] (const int j) {
         double p = 1.0 / (1.0 + exp(-lambda / pow(2, j + 1)));
-        return std::discrete_distribution({p, 1.0 - p});
+        return RandomBuffer::threshold(1.0 - p);
     });
 
     static std::vector<std::size_t> numbers = sequence<S>();
     std::for_each(std::execution::par_unseq, numbers.begin(), numbers.end(), [&] ([[maybe_unused]] const std::size_t _) {
-       histogram.add(biased_real(distributions));
+       histogram.add(biased_real(thresholds));
     });
 
     write_output(histogram, "sequence_biased" + std::to_string(static_cast<int>(lambda * 10)));
@@ -0,0 +1,23 @@
+#ifndef CUMULANT_RESULT_H
+#define CUMULANT_RESULT_H
+
+#include <array>
+#include <cstddef>
+#include <ostream>
+#include <sstream>
+
+struct CumulantResult {
+    CumulantResult() = default;
+    explicit CumulantResult(const size_t num_terms, const std::array<double, 4> & cumulants) : num_terms(num_terms), cumulants(cumulants) {};
+
+    friend std::ostream & operator<<(std::ostream & os, const CumulantResult & result) {
+        std::stringstream output;
+        output << result.num_terms << "," << result.cumulants[0] << "," << result.cumulants[1] << "," << result.cumulants[2] << "," << result.cumulants[3];
+        return os << output.str();
+    }
+
+    size_t num_terms;
+    std::array<double, 4> cumulants;
+};
+
+#endif //CUMULANT_RESULT_H
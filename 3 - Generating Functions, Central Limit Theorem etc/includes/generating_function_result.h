@@ -0,0 +1,20 @@
+#ifndef GENERATING_FUNCTION_RESULT_H
+#define GENERATING_FUNCTION_RESULT_H
+
+#include <ostream>
+#include <sstream>
+
+struct GeneratingFunctionResult {
+    GeneratingFunctionResult() = default;
+    explicit GeneratingFunctionResult(const double t, const double mgf, const double cgf, const double exact_cgf) : t(t), mgf(mgf), cgf(cgf), exact_cgf(exact_cgf) {};
+
+    friend std::ostream & operator<<(std::ostream & os, const GeneratingFunctionResult & result) {
+        std::stringstream output;
+        output << result.t << "," << result.mgf << "," << result.cgf << "," << result.exact_cgf;
+        return os << output.str();
+    }
+
+    double t, mgf, cgf, exact_cgf;
+};
+
+#endif //GENERATING_FUNCTION_RESULT_H
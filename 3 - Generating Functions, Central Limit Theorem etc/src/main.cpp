@@ -0,0 +1,160 @@
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <numbers>
+#include <ranges>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "cumulant_result.h"
+#include "distribution.h"
+#include "generating_function_result.h"
+#include "histogram.h"
+#include "random_buffer.h"
+#include "trace.h"
+#include "utils.h"
+
+/**
+ * The numbers of i.i.d. variables whose mean is calculated.
+ */
+const std::vector<size_t> NUM_TERMS { 1, 8, 32, 128, 512 };
+
+/**
+ * The number of sampled means per number of terms.
+ */
+constexpr size_t NUM_EXPERIMENTS = 100000;
+
+/**
+ * The number of bins of the sampled histograms.
+ */
+constexpr size_t NUM_BINS = 100;
+
+/**
+ * The discretization of the Laplace density on [-LAPLACE_CUTOFF, LAPLACE_CUTOFF].
+ */
+constexpr size_t NUM_GRID_POINTS = 8001;
+
+constexpr double LAPLACE_CUTOFF = 40.0;
+
+/**
+ * The histograms of the means cover this many standard deviations of the Laplace distribution around zero.
+ */
+constexpr double NUM_STANDARD_DEVIATIONS = 6.0;
+
+/**
+ * The Cauchy distribution does not narrow with the number of terms, so its histograms cover a fixed window.
+ */
+constexpr double CAUCHY_WINDOW = 20.0;
+
+/**
+ * The number of steps the range (-1, +1) of the argument of the generating functions is divided into.
+ */
+constexpr size_t NUM_T_STEPS = 99;
+
+/**
+ * The probability density of the standard Laplace distribution.
+ */
+double laplace_pdf(const double x) {
+    return std::exp(-std::abs(x)) / 2.0;
+}
+
+/**
+ * Samples the standard Laplace distribution by inverting its cumulative distribution. The top bit of the raw number
+ * decides the sign and the remaining 53 bits give the uniform number of the exponentially distributed magnitude.
+ */
+double sample_laplace() {
+    const uint64_t bits = RandomBuffer::local().next();
+    const double magnitude = -std::log1p(-static_cast<double>(bits & ((uint64_t { 1 } << 53) - 1)) * 0x1.0p-53);
+    return bits >> 63 ? magnitude : -magnitude;
+}
+
+/**
+ * Samples the standard Cauchy distribution by inverting its cumulative distribution.
+ */
+double sample_cauchy() {
+    return std::tan(std::numbers::pi * (RandomBuffer::local().uniform() - 0.5));
+}
+
+/**
+ * Writes the histogram to the output CSV file with the given name.
+ *
+ * @param histogram The histogram object
+ * @param name The name of the output file.
+ */
+void write_output(const histogram::Histogram & histogram, const std::string & name) {
+    std::ofstream output;
+    output.open("output/" + name + ".csv");
+
+    output << histogram << std::endl;
+    output.close();
+}
+
+/**
+ * Samples the means of the Laplace and Cauchy distributions in parallel into histograms.
+ */
+void sample_distributions() {
+    for (const size_t num_terms : NUM_TERMS) {
+        std::cout << "Sampling means of " << num_terms << " variables" << std::endl;
+        const TraceSpan span { "sample_means", { { "terms", num_terms } } };
+
+        const double window = NUM_STANDARD_DEVIATIONS * std::sqrt(2.0 / static_cast<double>(num_terms));
+        write_output(sample_means(sample_laplace, num_terms, NUM_EXPERIMENTS, -window, window, NUM_BINS), "laplace_sampled_" + std::to_string(num_terms));
+
+        write_output(sample_means(sample_cauchy, num_terms, NUM_EXPERIMENTS, -CAUCHY_WINDOW, CAUCHY_WINDOW, NUM_BINS), "cauchy_sampled_" + std::to_string(num_terms));
+    }
+}
+
+/**
+ * Calculates the exact distributions of the means of the Laplace distribution by repeated convolution and writes the
+ * densities and cumulants to CSV files.
+ */
+void convolve_distributions() {
+    const DiscreteDistribution laplace = DiscreteDistribution::from_pdf(laplace_pdf, -LAPLACE_CUTOFF, LAPLACE_CUTOFF, NUM_GRID_POINTS);
+
+    std::vector<CumulantResult> cumulants;
+    for (const size_t num_terms : NUM_TERMS) {
+        std::cout << "Convolving " << num_terms << " variables" << std::endl;
+        const TraceSpan span { "convolve", { { "terms", num_terms } } };
+        const DiscreteDistribution sum = laplace.power(num_terms);
+
+        cumulants.emplace_back(num_terms, std::array { sum.cumulant(1), sum.cumulant(2), sum.cumulant(3), sum.cumulant(4) });
+
+        const std::vector<DistributionPoint> density = sum.scaled(1.0 / static_cast<double>(num_terms)).density();
+        write_output_csv(std::span<const DistributionPoint>(density), "laplace_exact_" + std::to_string(num_terms), "x,density");
+    }
+
+    const std::span<const CumulantResult> span = cumulants;
+    write_output_csv(span, "laplace_cumulants", "n,k1,k2,k3,k4");
+}
+
+/**
+ * Evaluates the moment and cumulant generating functions of the discretized Laplace distribution on (-1, +1), where
+ * the exact cumulant generating function is -log(1 - t^2).
+ */
+void generating_functions() {
+    std::cout << "Calculating generating functions" << std::endl;
+    const DiscreteDistribution laplace = DiscreteDistribution::from_pdf(laplace_pdf, -LAPLACE_CUTOFF, LAPLACE_CUTOFF, NUM_GRID_POINTS);
+
+    std::vector<GeneratingFunctionResult> measurements;
+    for (const size_t i : std::views::iota(static_cast<size_t>(1), NUM_T_STEPS + 1)) {
+        const double t = 2.0 * static_cast<double>(i) / static_cast<double>(NUM_T_STEPS + 1) - 1.0;
+        measurements.emplace_back(t, laplace.moment_generating(t), laplace.cumulant_generating(t), -std::log(1.0 - t * t));
+    }
+
+    const std::span<const GeneratingFunctionResult> span = measurements;
+    write_output_csv(span, "laplace_generating_functions", "t,mgf,cgf,exact_cgf");
+}
+
+int main() {
+    std::filesystem::create_directory("output");
+    TraceSpan::enable("trace");
+
+    sample_distributions();
+    convolve_distributions();
+    generating_functions();
+}
@@ -6,14 +6,19 @@
 #include <iostream>
 #include <span>
 #include <string>
-#include <random>
+#include <numeric>
 #include <ranges>
+#include <sstream>
 #include <execution>
 
+#include <adaptive_result.h>
 #include <experiment.h>
 #include <lattice_scaling_result.h>
 #include <lattice_1d.h>
 #include <metropolis_result.h>
+#include <result_cache.h>
+#include <run_spec.h>
+#include <trace.h>
 #include <utils.h>
 
 /**
@@ -31,6 +36,31 @@ constexpr size_t NUM_EXPERIMENTS = 100;
  */
 constexpr size_t NUM_SWEEPS = 10000;
 
+/**
+ * The number of sweeps for each value of h when the lattice is carried over from the previous value of h.
+ */
+constexpr size_t NUM_ANNEALED_SWEEPS = 1000;
+
+/**
+ * The number of sweeps per window of the equilibration detector.
+ */
+constexpr size_t EQUILIBRATION_WINDOW = 50;
+
+/**
+ * The error target of the magnetization per spin for the error-targeted runs, which keep sweeping in blocks until the
+ * target or the budget of NUM_EXPERIMENTS * NUM_SWEEPS sweeps is reached.
+ */
+constexpr ErrorTarget ERROR_TARGET { .magnetization = 1e-3, .block_sweeps = 1000, .max_sweeps = NUM_EXPERIMENTS * NUM_SWEEPS, .absolute_magnetization = false };
+
+/**
+ * The algorithm of the error-targeted runs in the result cache, which includes every field of the target.
+ */
+static const std::string ERROR_TARGETED_ALGORITHM = [] {
+	std::stringstream algorithm;
+	algorithm << "metropolis_error_targeted," << ERROR_TARGET;
+	return algorithm.str();
+}();
+
 /**
  * The lattice size.
  */
@@ -47,14 +77,20 @@ constexpr double Beta = 1.0;
 constexpr double J = 0.75;
 
 /**
- * The Mersenne Twister 19937 uniform random number generator with random seed.
+ * The seed of the random number generator which is combined with the run specification.
+ */
+constexpr uint64_t SEED = 42;
+
+/**
+ * The version of the results computed by this driver.
  */
-static thread_local std::mt19937 generator {std::random_device()()};
+constexpr const char * CACHE_VERSION = "1";
 
 /**
- * A uniform distribution [0, 1] from which the generate can sample.
+ * The cache of the Monte Carlo results. Changes of the Common sources invalidate it automatically,
+ * the version must be bumped whenever a change of this driver alters the cached results.
  */
-static std::uniform_real_distribution uniform_distribution {0.0, 1.0};
+static ResultCache cache { "ising_1d", CACHE_VERSION };
 
 /**
  * Divides the range [-1,+1] of the external magnetic field into NUM_H_STEPS steps for iterating over them.
@@ -117,9 +153,19 @@ void measure_lattice_scaling()
  */
 MetropolisResult metropolis_hastings_multiple_experiments(const size_t num_experiments, const size_t num_samples, const double h)
 {
-	std::vector<double> measurements (num_experiments);
-	std::generate(std::execution::par, measurements.begin(), measurements.end(), [&] {
-		return Lattice1D(LATTICE_SIZE, Beta, J, h).metropolis_hastings(num_samples).magnetization;
+	const RunSpec spec { .lattice = "1d", .lattice_length = LATTICE_SIZE, .beta = Beta, .j = J, .h = h, .sweeps = num_samples, .experiments = num_experiments, .seed = SEED, .algorithm = "metropolis" };
+
+	std::vector<double> measurements = cache.fetch(spec, [&] {
+		std::vector<uint64_t> seeds (num_experiments);
+		std::iota(seeds.begin(), seeds.end(), spec.hash({}));
+
+		std::vector<double> magnetizations (num_experiments);
+		std::transform(std::execution::par, seeds.begin(), seeds.end(), magnetizations.begin(), [&] (const uint64_t seed) {
+			const TraceSpan span { "experiment", { { "h", h } } };
+			Lattice::seed(seed);
+			return Lattice1D(LATTICE_SIZE, Beta, J, h).metropolis_hastings(num_samples).magnetization;
+		});
+		return magnetizations;
 	});
 	return MetropolisResult { h, Experiment<double>(measurements) };
 }
@@ -142,6 +188,68 @@ void sweep_external_magnetic_field() {
 	write_output_csv(span, "metropolis", "h,magnetization,delta_magnetization");
 }
 
+/**
+ * Sweeps through the external magnetic field [-1,+1] while carrying the equilibrated lattice of every experiment from
+ * one value of h to the next. The sweeps needed to equilibrate at each value of h are discarded before measuring the
+ * mean magnetization and uncertainty per spin. Writes the results to a CSV file.
+ */
+void sweep_external_magnetic_field_annealed() {
+	std::cout << "Annealed Metropolis-Hastings" << std::endl;
+
+	std::vector<std::vector<double>> experiments (NUM_EXPERIMENTS);
+	std::atomic<size_t> discarded { 0 };
+
+	std::for_each(std::execution::par, experiments.begin(), experiments.end(), [&] (std::vector<double> & magnetizations) {
+		Lattice1D lattice { LATTICE_SIZE, Beta, J, stepped_magnetic_field().front() };
+		for (const double h : stepped_magnetic_field()) {
+			const TraceSpan span { "anneal_point", { { "h", h } } };
+			lattice.anneal(Beta, J, h);
+			discarded += lattice.equilibrate(EQUILIBRATION_WINDOW, NUM_SWEEPS);
+			magnetizations.emplace_back(lattice.metropolis_hastings(NUM_ANNEALED_SWEEPS).magnetization);
+		}
+	});
+
+	std::vector<MetropolisResult> measurements;
+	for (const size_t idx : std::views::iota(static_cast<size_t>(0), NUM_H_STEPS)) {
+		std::vector<double> magnetizations (NUM_EXPERIMENTS);
+		std::ranges::transform(experiments, magnetizations.begin(), [&] (const auto & experiment) { return experiment.at(idx); });
+		measurements.emplace_back(stepped_magnetic_field()[idx], Experiment<double>(magnetizations));
+	}
+	std::cout << "\tDiscarded " << discarded / NUM_EXPERIMENTS << " thermalization sweeps per experiment" << std::endl;
+
+	const std::span<const MetropolisResult> span = measurements;
+	write_output_csv(span, "metropolis_annealed", "h,magnetization,delta_magnetization");
+}
+
+/**
+ * Sweeps through the external magnetic field [-1,+1] with a single lattice per value of h, which keeps sweeping until
+ * the autocorrelation-corrected error of the magnetization per spin meets the target. Writes the estimates, effective
+ * sample sizes and stopping reasons to a CSV file.
+ */
+void sweep_external_magnetic_field_adaptive() {
+	std::cout << "Error-targeted Metropolis-Hastings" << std::endl;
+
+	std::vector<double> fields (NUM_H_STEPS);
+	std::ranges::copy(stepped_magnetic_field(), fields.begin());
+
+	std::vector<AdaptiveResult> measurements (NUM_H_STEPS);
+	std::transform(std::execution::par, fields.begin(), fields.end(), measurements.begin(), [] (const double h) {
+		const RunSpec spec { .lattice = "1d", .lattice_length = LATTICE_SIZE, .beta = Beta, .j = J, .h = h, .sweeps = ERROR_TARGET.max_sweeps, .seed = SEED, .algorithm = ERROR_TARGETED_ALGORITHM };
+		return AdaptiveResult(cache.fetch(spec, [&] {
+			Lattice::seed(spec.hash({}));
+			Lattice1D lattice { LATTICE_SIZE, Beta, J, h };
+			lattice.equilibrate(EQUILIBRATION_WINDOW, NUM_SWEEPS);
+			return lattice.run_until(h, ERROR_TARGET).serialize();
+		}));
+	});
+
+	const size_t total = std::ranges::fold_left(measurements, static_cast<size_t>(0), [] (const size_t sum, const AdaptiveResult & result) { return sum + result.sweeps; });
+	std::cout << "\tUsed " << total << " sweeps instead of " << NUM_H_STEPS * NUM_EXPERIMENTS * NUM_SWEEPS << std::endl;
+
+	const std::span<const AdaptiveResult> span = measurements;
+	write_output_csv(span, "metropolis_adaptive", "h,sweeps,energy,delta_energy,tau_energy,ess_energy,magnetization,delta_magnetization,tau_magnetization,ess_magnetization,reason");
+}
+
 /**
  * Runs code for problem set 4.
  *
@@ -150,9 +258,12 @@ void sweep_external_magnetic_field() {
 int main()
 {
     std::filesystem::create_directory("output");
+	TraceSpan::enable("trace");
 
 	measure_lattice_scaling();
 	sweep_external_magnetic_field();
+	sweep_external_magnetic_field_annealed();
+	sweep_external_magnetic_field_adaptive();
 
 	return 0;
 }
\ No newline at end of file
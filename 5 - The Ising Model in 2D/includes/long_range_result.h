@@ -0,0 +1,25 @@
+#ifndef LONG_RANGE_RESULT_H
+#define LONG_RANGE_RESULT_H
+
+#include <ostream>
+#include <sstream>
+
+/**
+ * The exact mean energy and magnetization per spin of a long-range lattice next to the estimates of its Metropolis and
+ * cluster updates.
+ */
+struct LongRangeResult {
+	friend std::ostream & operator<<(std::ostream & os, const LongRangeResult & result) {
+		std::stringstream output;
+		output << result.j << "," << result.exact_energy << "," << result.exact_magnetization << "," << result.metropolis_energy << ","
+			<< result.metropolis_magnetization << "," << result.cluster_energy << "," << result.cluster_magnetization;
+		return os << output.str();
+	}
+
+	double j = 0.0;
+	double exact_energy = 0.0, exact_magnetization = 0.0;
+	double metropolis_energy = 0.0, metropolis_magnetization = 0.0;
+	double cluster_energy = 0.0, cluster_magnetization = 0.0;
+};
+
+#endif //LONG_RANGE_RESULT_H
@@ -0,0 +1,20 @@
+#ifndef SWEEP_OVERHEAD_RESULT_H
+#define SWEEP_OVERHEAD_RESULT_H
+
+#include <experiment.h>
+
+struct SweepOverheadResult {
+	SweepOverheadResult() = default;
+	explicit SweepOverheadResult(std::size_t lattice_length, Experiment<int64_t> coroutine, Experiment<int64_t> batched);
+
+	friend std::ostream & operator<<(std::ostream & os, const SweepOverheadResult & measurement) {
+		std::stringstream output;
+		output << measurement.lattice_length << "," << measurement.coroutine << "," << measurement.batched;
+		return os << output.str();
+	}
+
+	std::size_t lattice_length;
+	Experiment<int64_t> coroutine, batched;
+};
+
+#endif //SWEEP_OVERHEAD_RESULT_H
@@ -1,20 +1,35 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
 #include <numbers>
 #include <cmath>
 #include <ranges>
 #include <vector>
 #include <filesystem>
 #include <execution>
+#include <functional>
 
 #include <utils.h>
+#include <result_cache.h>
+#include <run_spec.h>
+#include <time_series.h>
+#include <trace.h>
 #include <exact_result.h>
+#include <sweep_overhead_result.h>
+#include <long_range_result.h>
 #include <lattice.h>
 #include "lattice_2d.h"
+#include "lattice_graph.h"
+#include "lattice_long_range.h"
+#include "lattice_on.h"
 #include "lattice_observable.h"
 
 constexpr size_t NUM_INV_J_STEPS = 10000;
 
 constexpr size_t NUM_STEPS = 100000;
 
+constexpr size_t NUM_BENCHMARK_SWEEPS = 10000;
+
 constexpr double Beta = 1.0;
 
 constexpr double J = 0.5;
@@ -23,6 +38,59 @@ constexpr double H = 0.0;
 
 constexpr double Critical = std::log(1 + std::numbers::sqrt2) / 2.0;
 
+constexpr uint64_t SEED = 42;
+
+/**
+ * The number of buckets of the downsampled histories written next to the full histories.
+ */
+const std::vector<size_t> HISTORY_RESOLUTIONS { 100, 1000, 10000 };
+
+/**
+ * The lattice lengths for which the overhead of the coroutine sweeps is measured.
+ */
+const std::vector<size_t> BENCHMARK_LENGTHS { 2, 4, 8, 16 };
+
+/**
+ * The disordered lattices on interaction graphs are sampled for NUM_GRAPH_J_STEPS coupling constants with
+ * NUM_GRAPH_SWEEPS sweeps after discarding a tenth of them, the diluted lattice keeps every bond with the given
+ * occupation probability.
+ */
+constexpr size_t GRAPH_LATTICE_LENGTH = 16;
+constexpr size_t NUM_GRAPH_J_STEPS = 50;
+constexpr size_t NUM_GRAPH_SWEEPS = 10000;
+constexpr double DILUTED_OCCUPATION = 0.75;
+
+/**
+ * The O(n) models are sampled for NUM_ON_J_STEPS coupling constants with NUM_ON_SWEEPS sweeps after discarding a tenth
+ * of them, every sweep consisting of a heat-bath sweep and ON_OVER_RELAXATIONS over-relaxation sweeps.
+ */
+constexpr size_t ON_LATTICE_LENGTH = 16;
+constexpr size_t NUM_ON_J_STEPS = 40;
+constexpr size_t NUM_ON_SWEEPS = 10000;
+constexpr size_t ON_OVER_RELAXATIONS = 2;
+
+/**
+ * The long-range lattice with couplings j / r^LONG_RANGE_ALPHA is compared against the exact enumeration of all
+ * configurations of a LONG_RANGE_EXACT_LENGTH x LONG_RANGE_EXACT_LENGTH lattice for NUM_LONG_RANGE_J_STEPS coupling
+ * constants, in a field which breaks the symmetry so the mean magnetization is meaningful.
+ */
+constexpr double LONG_RANGE_ALPHA = 3.0;
+constexpr double LONG_RANGE_H = 0.1;
+constexpr size_t LONG_RANGE_EXACT_LENGTH = 4;
+constexpr size_t NUM_LONG_RANGE_J_STEPS = 20;
+constexpr size_t NUM_LONG_RANGE_SWEEPS = 100000;
+
+/**
+ * The version of the results computed by this driver.
+ */
+constexpr const char * CACHE_VERSION = "1";
+
+/**
+ * The cache of the exact and Monte Carlo results. Changes of the Common sources invalidate it automatically,
+ * the version must be bumped whenever a change of this driver alters the cached results.
+ */
+static ResultCache cache { "ising_2d", CACHE_VERSION };
+
 /**
  * Calculates the exact magnetization of the 2D Ising model.
  *
@@ -60,7 +128,11 @@ void calculate_exact_results()
 
 	std::vector<ExactResult> measurements (NUM_INV_J_STEPS);
 	std::ranges::transform(sweep_through_inv_j(), measurements.begin(), [] (const double j) {
-		return ExactResult { j, exact_energy(j), exact_magnetization(j) };
+		const RunSpec spec { .lattice = "2d", .beta = Beta, .j = j, .h = H, .algorithm = "exact" };
+		const std::vector<double> values = cache.fetch(spec, [=] {
+			return std::vector { exact_energy(j), exact_magnetization(j) };
+		});
+		return ExactResult { j, values.at(0), values.at(1) };
 	});
 
 	const std::span<const ExactResult> span = measurements;
@@ -70,22 +142,233 @@ void calculate_exact_results()
 void monte_carlo_history(const size_t lattice_length)
 {
 	std::cout << "Metropolis-Hastings for N = " << lattice_length << std::endl;
+	const TraceSpan span { "monte_carlo_history", { { "lattice_length", lattice_length } } };
+
+	const RunSpec spec { .lattice = "2d", .lattice_length = lattice_length, .beta = Beta, .j = J, .h = H, .sweeps = NUM_STEPS, .seed = SEED, .algorithm = "metropolis_history" };
+	const std::vector<LatticeObservable> measurements = deserialize_history(cache.fetch(spec, [&] {
+		Lattice::seed(spec.hash({}));
+
+		std::vector<LatticeObservable> history;
+		history.reserve(NUM_STEPS);
+		Lattice2D(lattice_length, Beta, J, H).run(NUM_STEPS, [&] (const std::span<const LatticeObservable> block) {
+			std::ranges::transform(block, std::back_inserter(history), [=] (const auto current) {
+				return current / std::pow(lattice_length, 2.0);
+			});
+		});
+		return serialize_history(history);
+	}), J);
+
+	write_output_csv(std::span<const LatticeObservable>(measurements), "history_" + std::to_string(lattice_length), "j,sweeps,energy,magnetization");
+
+	ObservableHistory history { J, lattice_length * lattice_length };
+	{
+		const TraceSpan compress_span { "compress_history" };
+		std::ranges::for_each(measurements, [&] (const auto & current) { history.push(current); });
+	}
+	history.write("history_" + std::to_string(lattice_length));
+
+	for (const size_t buckets : HISTORY_RESOLUTIONS) {
+		const std::vector<HistoryBucket> downsampled = history.downsample(buckets);
+		const std::span<const HistoryBucket> downsampled_span = downsampled;
+		write_output_csv(downsampled_span, "history_" + std::to_string(lattice_length) + "_" + std::to_string(buckets),
+			"sweeps,energy_min,energy_max,energy_mean,magnetization_min,magnetization_max,magnetization_mean");
+	}
+	std::cout << "\tCompressed history to " << history.compressed_bytes() << " bytes" << std::endl;
+}
 
-	std::vector<LatticeObservable> measurements (NUM_STEPS);
-	std::ranges::transform(Lattice2D(lattice_length, Beta, J, H).sweeps() | std::views::take(NUM_STEPS), measurements.begin(), [=] (const auto current) {
-		return current / std::pow(lattice_length, 2.0);
+/**
+ * Samples the mean energy and magnetization per spin of an Edwards-Anderson spin glass and of a bond diluted lattice,
+ * both on periodic square interaction graphs with the same disorder for every coupling constant.
+ */
+void graph_lattices()
+{
+	std::vector<double> js (NUM_GRAPH_J_STEPS);
+	for (size_t i = 0; i < NUM_GRAPH_J_STEPS; ++i) js[i] = 0.05 * static_cast<double>(i + 1);
+
+	for (const std::string kind : { "edwards_anderson", "diluted" }) {
+		std::cout << "Metropolis-Hastings on the " << kind << " interaction graph" << std::endl;
+		const TraceSpan span { "graph_lattices" };
+
+		std::vector<LatticeObservable> measurements (js.size());
+		std::transform(std::execution::par, js.begin(), js.end(), measurements.begin(), [&] (const double j) {
+			const std::string lattice = kind == "diluted" ? kind + "_" + std::to_string(DILUTED_OCCUPATION) : kind;
+			const RunSpec spec { .lattice = lattice, .lattice_length = GRAPH_LATTICE_LENGTH, .beta = Beta, .j = j, .h = H, .sweeps = NUM_GRAPH_SWEEPS, .seed = SEED, .algorithm = "metropolis_graph" };
+			const std::vector<double> values = cache.fetch(spec, [&] {
+				Lattice::seed(spec.hash({}));
+				GraphLattice graph = kind == "diluted"
+					? GraphLattice::diluted(GRAPH_LATTICE_LENGTH, DILUTED_OCCUPATION, Beta, j, H, SEED)
+					: GraphLattice::edwards_anderson(GRAPH_LATTICE_LENGTH, Beta, j, H, SEED);
+				static_cast<void>(graph.metropolis_hastings(NUM_GRAPH_SWEEPS / 10));
+				const LatticeObservable mean = graph.metropolis_hastings(NUM_GRAPH_SWEEPS);
+				return std::vector { mean.energy, mean.magnetization };
+			});
+			return LatticeObservable { NUM_GRAPH_SWEEPS, j, values.at(0), values.at(1) };
+		});
+
+		write_output_csv(std::span<const LatticeObservable>(measurements), "graph_" + kind, "j,sweeps,energy,magnetization");
+	}
+}
+
+/**
+ * Samples the mean energy and modulus of the magnetization per spin of the O(n) model with n spin components.
+ *
+ * @param name The name of the model, which names the output file.
+ */
+template<size_t N>
+void on_model(const std::string & name)
+{
+	std::cout << "Heat-bath and over-relaxation sweeps of the " << name << " model" << std::endl;
+	const TraceSpan span { "on_model" };
+
+	std::vector<double> js (NUM_ON_J_STEPS);
+	for (size_t i = 0; i < NUM_ON_J_STEPS; ++i) js[i] = 0.05 * static_cast<double>(i + 1);
+
+	std::vector<LatticeObservable> measurements (js.size());
+	std::transform(std::execution::par, js.begin(), js.end(), measurements.begin(), [&] (const double j) {
+		const RunSpec spec { .lattice = name, .lattice_length = ON_LATTICE_LENGTH, .beta = Beta, .j = j, .h = H, .sweeps = NUM_ON_SWEEPS, .seed = SEED,
+			.algorithm = "heat_bath_over_relaxation_" + std::to_string(ON_OVER_RELAXATIONS) };
+		const std::vector<double> values = cache.fetch(spec, [&] {
+			OnLattice<N>::seed(spec.hash({}));
+			OnLattice<N> lattice { ON_LATTICE_LENGTH, Beta, j, H, OnLattice<N>::Update::HeatBath, ON_OVER_RELAXATIONS };
+			static_cast<void>(lattice.metropolis_hastings(NUM_ON_SWEEPS / 10));
+			const LatticeObservable mean = lattice.metropolis_hastings(NUM_ON_SWEEPS);
+			return std::vector { mean.energy, mean.magnetization };
+		});
+		return LatticeObservable { NUM_ON_SWEEPS, j, values.at(0), values.at(1) };
+	});
+
+	write_output_csv(std::span<const LatticeObservable>(measurements), name + "_model", "j,sweeps,energy,magnetization");
+}
+
+/**
+ * Calculates the exact mean energy and magnetization per spin of a small long-range lattice by enumerating all
+ * configurations. The coupling of every pair of sites is 1 / r^alpha with the minimum image distance r.
+ *
+ * @param lattice_length The side length of the lattice, at most 5.
+ * @param j The coupling constant j.
+ * @return The mean energy and magnetization per spin.
+ */
+std::array<double, 2> exact_long_range(const size_t lattice_length, const double j)
+{
+	const size_t num_sites = lattice_length * lattice_length;
+	assert(num_sites < 32);
+
+	std::vector<double> couplings (num_sites * num_sites);
+	for (size_t i = 0; i < num_sites; ++i) {
+		for (size_t k = i + 1; k < num_sites; ++k) {
+			const size_t dx = (k % lattice_length + lattice_length - i % lattice_length) % lattice_length, dy = (k / lattice_length + lattice_length - i / lattice_length) % lattice_length;
+			const auto x = static_cast<double>(std::min(dx, lattice_length - dx)), y = static_cast<double>(std::min(dy, lattice_length - dy));
+			couplings[i * num_sites + k] = std::pow(x * x + y * y, -LONG_RANGE_ALPHA / 2.0);
+		}
+	}
+
+	double partition = 0.0, energy = 0.0, magnetization = 0.0;
+	for (uint32_t configuration = 0; configuration < (1u << num_sites); ++configuration) {
+		const auto spin = [=] (const size_t i) { return configuration >> i & 1 ? 1.0 : -1.0; };
+
+		double bonds = 0.0, spins = 0.0;
+		for (size_t i = 0; i < num_sites; ++i) {
+			spins += spin(i);
+			for (size_t k = i + 1; k < num_sites; ++k) bonds += couplings[i * num_sites + k] * spin(i) * spin(k);
+		}
+
+		const double current = -j * bonds - LONG_RANGE_H * spins, weight = std::exp(-Beta * current);
+		partition += weight;
+		energy += weight * current;
+		magnetization += weight * spins;
+	}
+	return { energy / partition / static_cast<double>(num_sites), magnetization / partition / static_cast<double>(num_sites) };
+}
+
+/**
+ * Samples the long-range lattice with the Metropolis and the cluster update and compares both against the exact
+ * enumeration of the small lattice. At strong coupling the Metropolis update no longer tunnels into the ordered state
+ * against the field within the run, so only the cluster update reproduces the exact results there.
+ */
+void long_range_model()
+{
+	std::cout << "Long-range lattice against exact enumeration for N = " << LONG_RANGE_EXACT_LENGTH << std::endl;
+	const TraceSpan trace_span { "long_range_model" };
+
+	std::vector<double> js (NUM_LONG_RANGE_J_STEPS);
+	for (size_t i = 0; i < NUM_LONG_RANGE_J_STEPS; ++i) js[i] = 0.05 * static_cast<double>(i + 1);
+
+	std::vector<LongRangeResult> measurements (js.size());
+	std::transform(std::execution::par, js.begin(), js.end(), measurements.begin(), [&] (const double j) {
+		const auto sample = [&] (const LongRangeLattice::Update update, const std::string & algorithm) {
+			const RunSpec spec { .lattice = "long_range_" + std::to_string(LONG_RANGE_ALPHA), .lattice_length = LONG_RANGE_EXACT_LENGTH, .beta = Beta,
+				.j = j, .h = LONG_RANGE_H, .sweeps = NUM_LONG_RANGE_SWEEPS, .seed = SEED, .algorithm = algorithm };
+			return cache.fetch(spec, [&] {
+				LongRangeLattice::seed(spec.hash({}));
+				LongRangeLattice lattice { LONG_RANGE_EXACT_LENGTH, LONG_RANGE_ALPHA, Beta, j, LONG_RANGE_H, update };
+				static_cast<void>(lattice.metropolis_hastings(NUM_LONG_RANGE_SWEEPS / 10));
+				const LatticeObservable mean = lattice.metropolis_hastings(NUM_LONG_RANGE_SWEEPS);
+				return std::vector { mean.energy, mean.magnetization };
+			});
+		};
+
+		const auto [exact_energy, exact_magnetization] = exact_long_range(LONG_RANGE_EXACT_LENGTH, j);
+		const std::vector<double> metropolis = sample(LongRangeLattice::Update::Metropolis, "metropolis");
+		const std::vector<double> cluster = sample(LongRangeLattice::Update::Cluster, "luijten_bloete");
+		return LongRangeResult { j, exact_energy, exact_magnetization, metropolis.at(0), metropolis.at(1), cluster.at(0), cluster.at(1) };
 	});
 
-	const std::span<const LatticeObservable> span = measurements;
-	write_output_csv(span, "history_" + std::to_string(lattice_length), "j,sweeps,energy,magnetization");
+	double metropolis_deviation = 0.0, cluster_deviation = 0.0;
+	for (const LongRangeResult & result : measurements) {
+		metropolis_deviation = std::max(metropolis_deviation, std::abs(result.metropolis_energy - result.exact_energy));
+		cluster_deviation = std::max(cluster_deviation, std::abs(result.cluster_energy - result.exact_energy));
+	}
+	std::cout << "\tLargest deviation of the energy per spin from the exact result: " << metropolis_deviation << " (Metropolis), "
+		<< cluster_deviation << " (cluster)" << std::endl;
+
+	const std::span<const LongRangeResult> span = measurements;
+	write_output_csv(span, "long_range_" + std::to_string(LONG_RANGE_EXACT_LENGTH),
+		"j,exact_energy,exact_magnetization,metropolis_energy,metropolis_magnetization,cluster_energy,cluster_magnetization");
+}
+
+/**
+ * Measures how long NUM_BENCHMARK_SWEEPS sweeps take when the observables are folded through the coroutine sweeps
+ * compared to the batched sweeps of run. The difference is the overhead of resuming the coroutine after every sweep.
+ */
+void measure_sweep_overhead()
+{
+	std::cout << "Measuring overhead of coroutine sweeps against batched sweeps" << std::endl;
+
+	std::vector<SweepOverheadResult> measurements;
+	for (const size_t lattice_length : BENCHMARK_LENGTHS) {
+		const Experiment<int64_t> coroutine = measure_execution([=] -> void {
+			Lattice2D lattice { lattice_length, Beta, J, H };
+			static_cast<void>(std::ranges::fold_left(lattice.sweeps() | std::views::take(NUM_BENCHMARK_SWEEPS), LatticeObservable { 0, J, 0.0, 0.0 }, std::plus()));
+		}, 20);
+
+		const Experiment<int64_t> batched = measure_execution([=] -> void {
+			Lattice2D lattice { lattice_length, Beta, J, H };
+			LatticeObservable sum { 0, J, 0.0, 0.0 };
+			lattice.run(NUM_BENCHMARK_SWEEPS, [&] (const std::span<const LatticeObservable> block) {
+				sum = std::ranges::fold_left(block, sum, std::plus());
+			});
+		}, 20);
+
+		std::cout << "\tN = " << lattice_length << ": " << coroutine.mean << " ns (coroutine) against " << batched.mean << " ns (batched)" << std::endl;
+		measurements.emplace_back(lattice_length, coroutine, batched);
+	}
+
+	const std::span<const SweepOverheadResult> span = measurements;
+	write_output_csv(span, "sweep_overhead", "Lattice,Coroutine,DeltaCoroutine,Batched,DeltaBatched");
 }
 
 int main()
 {
 	std::filesystem::create_directory("output");
+	TraceSpan::enable("trace");
 
 	calculate_exact_results();
 	monte_carlo_history(4);
 	monte_carlo_history(8);
 	monte_carlo_history(12);
+	graph_lattices();
+	on_model<2>("xy");
+	on_model<3>("heisenberg");
+	long_range_model();
+	measure_sweep_overhead();
 }
@@ -0,0 +1,4 @@
+#include "sweep_overhead_result.h"
+
+SweepOverheadResult::SweepOverheadResult(const std::size_t lattice_length, const Experiment<int64_t> coroutine, const Experiment<int64_t> batched) : lattice_length(lattice_length), coroutine(coroutine), batched(batched)
+{ }
@@ -4,27 +4,104 @@
 #include <ranges>
 #include <algorithm>
 #include <filesystem>
+#include <map>
 #include <execution>
-#include <mutex>
+#include <functional>
+#include <numeric>
+#include <sstream>
 
+#include "adaptive_result.h"
+#include "async_writer.h"
+#include "binder_scan.h"
+#include "block_spin.h"
+#include "cluster_analysis.h"
 #include "lattice_2d.h"
+#include "n_fold_way.h"
 #include "exact_result.h"
 #include "utils.h"
+#include "result_cache.h"
+#include "run_spec.h"
+#include "snapshot_stream.h"
+#include "trace.h"
 
 constexpr size_t NUM_INV_J_STEPS = 10000;
 
 constexpr size_t NUM_STEPS = 10000;
 
+constexpr size_t EQUILIBRATION_WINDOW = 100;
+
 constexpr double Beta = 1.0;
 
 constexpr double H = 0.0;
 
 constexpr double Critical = std::log(1 + std::numbers::sqrt2) / 2.0;
 
+constexpr uint64_t SEED = 42;
+
+/**
+ * The number of observables handed to the CSV writer at once when a history is replayed from the cache.
+ */
+constexpr size_t REPLAY_BLOCK_SIZE = 1024;
+
+constexpr size_t NUM_COARSE_J_STEPS = 9;
+
+constexpr size_t MAX_REFINEMENTS = 8;
+
+constexpr double BINDER_TOLERANCE = 1e-3;
+
+/**
+ * The error-targeted runs keep sweeping until the errors of the energy and absolute magnetization per spin meet the
+ * target, with at most ten times the sweeps of the fixed-length runs.
+ */
+constexpr ErrorTarget ERROR_TARGET { .energy = 2e-3, .magnetization = 2e-3, .block_sweeps = 1000, .max_sweeps = 10 * NUM_STEPS };
+
+/**
+ * The algorithm of the error-targeted runs in the result cache, which includes every field of the target.
+ */
+static const std::string ERROR_TARGETED_ALGORITHM = [] {
+    std::stringstream algorithm;
+    algorithm << "metropolis_error_targeted," << ERROR_TARGET;
+    return algorithm.str();
+}();
+
 const std::vector<size_t> LATTICE_SIZES { 4, 8, 12 };
 
 const std::vector SPONTANEOUS_MAGNETIZATION_J { 0.1, 0.2, Critical, 0.7, 0.8 };
 
+/**
+ * The domains are analysed at the critical point every CLUSTER_INTERVAL sweeps for NUM_CLUSTER_SAMPLES samples.
+ */
+const std::vector<size_t> CLUSTER_LATTICE_SIZES { 16, 32, 64, 128 };
+
+constexpr size_t NUM_CLUSTER_SAMPLES = 200;
+
+constexpr size_t CLUSTER_INTERVAL = 10;
+
+/**
+ * The renormalization group analysis blocks the configurations of MCRG_LATTICE_SIZE lattices at the critical point
+ * MCRG_LEVELS times, sampled every MCRG_INTERVAL sweeps from NUM_MCRG_CHAINS independent chains.
+ */
+constexpr size_t MCRG_LATTICE_SIZE = 64;
+
+constexpr size_t MCRG_LEVELS = 4;
+
+constexpr size_t NUM_MCRG_CHAINS = 8;
+
+constexpr size_t NUM_MCRG_SAMPLES = 500;
+
+constexpr size_t MCRG_INTERVAL = 10;
+
+/**
+ * The version of the results computed by this driver.
+ */
+constexpr const char * CACHE_VERSION = "1";
+
+/**
+ * The cache of the exact and Monte Carlo results. Changes of the Common sources invalidate it automatically,
+ * the version must be bumped whenever a change of this driver alters the cached results.
+ */
+static ResultCache cache { "ising_2d_critical_slowing_down", CACHE_VERSION };
+
 /**
  * Calculates the exact magnetization of the 2D Ising model.
  *
@@ -62,7 +139,11 @@ void calculate_exact_results()
 
     std::vector<ExactResult> measurements (NUM_INV_J_STEPS);
     std::ranges::transform(exact_sweep_through_inv_j(), measurements.begin(), [] (const double j) {
-        return ExactResult { j, exact_energy(j), exact_magnetization(j) };
+        const RunSpec spec { .lattice = "2d", .beta = Beta, .j = j, .h = H, .algorithm = "exact" };
+        const std::vector<double> values = cache.fetch(spec, [=] {
+            return std::vector { exact_energy(j), exact_magnetization(j) };
+        });
+        return ExactResult { j, values.at(0), values.at(1) };
     });
 
     const std::span<const ExactResult> span = measurements;
@@ -75,34 +156,289 @@ Lattice2D checkerboard_lattice(const size_t lattice_size, const double j) {
     return Lattice2D { Beta, j, H, spins };
 }
 
-std::vector<LatticeObservable> metropolis_fixed_j(const size_t lattice_length, const double j)
+/**
+ * Streams the history per spin of a run from the cache to the sink in blocks. On a cache miss the history is computed
+ * by the given run, whose blocks reach the sink while the lattice is still being swept and are appended to the cache
+ * one by one, so the history is never held in memory as a whole.
+ *
+ * @param spec The specification of the run.
+ * @param lattice_length The side length of the lattice.
+ * @param run Performs the run and hands its blocks of observables to the given sink.
+ * @param sink Receives the blocks of the history per spin.
+ */
+void stream_history(const RunSpec & spec, const size_t lattice_length, const std::function<void(const Lattice::ObservableSink &)> & run, const Lattice::ObservableSink & sink)
 {
-    std::cout << "\tSimulating for J = " + std::to_string(j) + "\n";
+    cache.stream(spec, [&] (const ResultCache::ValueSink & append) {
+        std::vector<LatticeObservable> normalized;
+        run([&] (const std::span<const LatticeObservable> block) {
+            normalized.clear();
+            std::ranges::transform(block, std::back_inserter(normalized), [=] (const auto current) {
+                return current / std::pow(lattice_length, 2.0);
+            });
+            sink(normalized);
+            append(serialize_history(normalized));
+        });
+    }, [&] (const std::span<const double> values) {
+        sink(deserialize_history(values, spec.j));
+    }, 3 * REPLAY_BLOCK_SIZE);
+}
 
-    std::vector<LatticeObservable> measurements (NUM_STEPS);
-    std::ranges::transform(checkerboard_lattice(lattice_length, j).sweeps() | std::views::take(NUM_STEPS), measurements.begin(), [=] (const auto current) {
-        return current / std::pow(lattice_length, 2.0);
-    });
+void metropolis_fixed_j(const size_t lattice_length, const double j, const Lattice::ObservableSink & sink)
+{
+    std::cout << "\tSimulating for J = " + std::to_string(j) + "\n";
+    const TraceSpan span { "metropolis_fixed_j", { { "lattice_length", lattice_length }, { "j", j } } };
 
-    return measurements;
+    const RunSpec spec { .lattice = "2d", .lattice_length = lattice_length, .beta = Beta, .j = j, .h = H, .sweeps = NUM_STEPS, .seed = SEED, .algorithm = "metropolis_checkerboard_history" };
+    stream_history(spec, lattice_length, [&] (const Lattice::ObservableSink & normalize) {
+        Lattice::seed(spec.hash({}));
+        checkerboard_lattice(lattice_length, j).run(NUM_STEPS, normalize);
+    }, sink);
 }
 
-void metropolis_sweep_j(std::vector<double> range, const std::string & prefix) {
+/**
+ * Simulates the given coupling constants in parallel and writes the histories to one file per lattice length, one
+ * contiguous section per coupling constant in the order of the range.
+ */
+void metropolis_sweep_j(const std::vector<double> & range, const std::string & prefix) {
+    std::vector<size_t> indices (range.size());
+    std::iota(indices.begin(), indices.end(), static_cast<size_t>(0));
+
     for (const size_t lattice_length : LATTICE_SIZES) {
         std::cout << "Simulating various J for N = " << lattice_length << std::endl;
 
-        std::mutex measurements_mtx;
-        std::vector<LatticeObservable> measurements;
+        AsyncCsvWriter<LatticeObservable> writer { prefix + std::to_string(lattice_length), "j,sweeps,energy,magnetization" };
+        std::for_each(std::execution::par, indices.begin(), indices.end(), [&] (const size_t index) {
+            metropolis_fixed_j(lattice_length, range[index], [&] (const std::span<const LatticeObservable> block) {
+                writer.push(index, block);
+            });
+            writer.finish(index);
+        });
+    }
+}
+
+/**
+ * Simulates the same parameters as metropolis_fixed_j with the rejection-free n-fold way, which advances NUM_STEPS
+ * sweeps of physical time while only spending work on the accepted flips. The history follows continuous-time
+ * random-site dynamics, so its equilibrium averages match the checkerboard histories but its autocorrelation times do
+ * not.
+ */
+void n_fold_way_fixed_j(const size_t lattice_length, const double j, const Lattice::ObservableSink & sink)
+{
+    const TraceSpan span { "n_fold_way_fixed_j", { { "lattice_length", lattice_length }, { "j", j } } };
 
-        std::for_each(std::execution::par, range.begin(), range.end(), [&] (const double j) mutable {
-            const std::vector<LatticeObservable> intermediate = metropolis_fixed_j(lattice_length, j);
-            std::lock_guard measurements_lock (measurements_mtx);
-            measurements.insert(measurements.end(), intermediate.begin(), intermediate.end());
+    const RunSpec spec { .lattice = "2d", .lattice_length = lattice_length, .beta = Beta, .j = j, .h = H, .sweeps = NUM_STEPS, .seed = SEED, .algorithm = "n_fold_way_checkerboard_history" };
+    stream_history(spec, lattice_length, [&] (const Lattice::ObservableSink & normalize) {
+        NFoldWay::seed(spec.hash({}));
+        Lattice2D lattice = checkerboard_lattice(lattice_length, j);
+        NFoldWay engine { lattice };
+        engine.run(NUM_STEPS, normalize);
+        std::cout << "\tSimulated J = " + std::to_string(j) + " with " + std::to_string(engine.flips()) + " flips\n";
+    }, sink);
+}
+
+void n_fold_way_sweep_j(const std::vector<double> & range, const std::string & prefix) {
+    std::vector<size_t> indices (range.size());
+    std::iota(indices.begin(), indices.end(), static_cast<size_t>(0));
+
+    for (const size_t lattice_length : LATTICE_SIZES) {
+        std::cout << "Simulating various J with the n-fold way for N = " << lattice_length << std::endl;
+
+        AsyncCsvWriter<LatticeObservable> writer { prefix + std::to_string(lattice_length), "j,sweeps,energy,magnetization" };
+        std::for_each(std::execution::par, indices.begin(), indices.end(), [&] (const size_t index) {
+            n_fold_way_fixed_j(lattice_length, range[index], [&] (const std::span<const LatticeObservable> block) {
+                writer.push(index, block);
+            });
+            writer.finish(index);
         });
+    }
+}
 
-        const std::span<const LatticeObservable> span = measurements;
-        write_output_csv(span, prefix + std::to_string(lattice_length), "j,sweeps,energy,magnetization");
+/**
+ * Scans through the given coupling constants in ascending order while carrying the equilibrated lattice from one
+ * value of J to the next. At every J the sweeps needed to equilibrate are discarded before the history is recorded.
+ *
+ * @param range The coupling constants to scan through.
+ * @param prefix The prefix of the output file names.
+ */
+void metropolis_anneal_j(std::vector<double> range, const std::string & prefix) {
+    std::ranges::sort(range);
+    for (const size_t lattice_length : LATTICE_SIZES) {
+        std::cout << "Annealing through J for N = " << lattice_length << std::endl;
+
+        AsyncCsvWriter<LatticeObservable> writer { prefix + std::to_string(lattice_length), "j,sweeps,energy,magnetization" };
+        Lattice2D lattice = checkerboard_lattice(lattice_length, range.front());
+
+        for (const double j : range) {
+            const TraceSpan span { "anneal_point", { { "lattice_length", lattice_length }, { "j", j } } };
+            lattice.anneal(Beta, j, H);
+            const size_t discarded = lattice.equilibrate(EQUILIBRATION_WINDOW, NUM_STEPS);
+            std::cout << "\tDiscarded " << discarded << " sweeps for J = " << std::to_string(j) << "\n";
+
+            lattice.run(NUM_STEPS, [&] (const std::span<const LatticeObservable> block) {
+                std::vector<LatticeObservable> measurements (block.size());
+                std::ranges::transform(block, measurements.begin(), [=] (const auto current) {
+                    return current / std::pow(lattice_length, 2.0);
+                });
+                writer.push(measurements);
+            });
+        }
+    }
+}
+
+/**
+ * Equilibrates a lattice at the given J and records the magnetization per spin after every sweep.
+ *
+ * @param lattice_length The side length of the lattice.
+ * @param j The coupling constant j.
+ * @return The history of magnetizations per spin.
+ */
+std::vector<double> metropolis_binder(const size_t lattice_length, const double j) {
+    const TraceSpan span { "metropolis_binder", { { "lattice_length", lattice_length }, { "j", j } } };
+    const RunSpec spec { .lattice = "2d", .lattice_length = lattice_length, .beta = Beta, .j = j, .h = H, .sweeps = NUM_STEPS, .seed = SEED, .algorithm = "metropolis_binder" };
+    return cache.fetch(spec, [&] {
+        Lattice::seed(spec.hash({}));
+        Lattice2D lattice = checkerboard_lattice(lattice_length, j);
+        lattice.equilibrate(EQUILIBRATION_WINDOW, NUM_STEPS);
+
+        std::vector<double> magnetizations;
+        magnetizations.reserve(NUM_STEPS);
+        lattice.run(NUM_STEPS, [&] (const std::span<const LatticeObservable> block) {
+            std::ranges::transform(block, std::back_inserter(magnetizations), [=] (const auto current) {
+                return current.magnetization / std::pow(lattice_length, 2.0);
+            });
+        });
+        return magnetizations;
+    });
+}
+
+/**
+ * Starts from a coarse grid of J and refines it where the Binder cumulants of consecutive lattice sizes cross or the
+ * susceptibility peaks, until the crossings are known to the target precision.
+ *
+ * @param prefix The prefix of the output file names.
+ */
+void metropolis_adaptive_j(const std::string & prefix) {
+    std::cout << "Refining J around the Binder cumulant crossings" << std::endl;
+
+    std::vector<double> grid (NUM_COARSE_J_STEPS);
+    std::ranges::generate(grid, [n = 0.0] mutable { return 1.0 / (1.0 + 3.0 * n++ / (NUM_COARSE_J_STEPS - 1)); });
+
+    BinderScan scan { LATTICE_SIZES, Beta, grid, metropolis_binder };
+    for (const BinderCrossing & crossing : scan.refine(BINDER_TOLERANCE, MAX_REFINEMENTS)) {
+        std::cout << "\tCrossing of N = " << crossing.smaller << " and N = " << crossing.larger << " at J = " << crossing.j << " +/- " << crossing.uncertainty << " (exact " << Critical << ")\n";
     }
+
+    for (const size_t lattice_length : LATTICE_SIZES) {
+        const std::vector<BinderPoint> points = scan.points(lattice_length);
+        const std::span<const BinderPoint> span = points;
+        write_output_csv(span, prefix + std::to_string(lattice_length), "j,samples,binder,binder_error,susceptibility,susceptibility_error");
+    }
+}
+
+/**
+ * Equilibrates a lattice at every J and sweeps until the error target is met, so points far from the critical point
+ * stop early while points close to it get the budget. Writes the estimates, effective sample sizes and stopping
+ * reasons per lattice size.
+ *
+ * @param range The coupling constants to scan through.
+ * @param prefix The prefix of the output file names.
+ */
+void metropolis_error_targeted_j(const std::vector<double> & range, const std::string & prefix) {
+    for (const size_t lattice_length : LATTICE_SIZES) {
+        std::cout << "Error-targeted runs for N = " << lattice_length << std::endl;
+
+        std::vector<AdaptiveResult> measurements (range.size());
+        std::transform(std::execution::par, range.begin(), range.end(), measurements.begin(), [=] (const double j) {
+            const TraceSpan span { "metropolis_error_targeted", { { "lattice_length", lattice_length }, { "j", j } } };
+            const RunSpec spec { .lattice = "2d", .lattice_length = lattice_length, .beta = Beta, .j = j, .h = H, .sweeps = ERROR_TARGET.max_sweeps, .seed = SEED, .algorithm = ERROR_TARGETED_ALGORITHM };
+            return AdaptiveResult(cache.fetch(spec, [&] {
+                Lattice::seed(spec.hash({}));
+                Lattice2D lattice = checkerboard_lattice(lattice_length, j);
+                lattice.equilibrate(EQUILIBRATION_WINDOW, NUM_STEPS);
+                return lattice.run_until(j, ERROR_TARGET).serialize();
+            }));
+        });
+
+        const size_t total = std::ranges::fold_left(measurements, static_cast<size_t>(0), [] (const size_t sum, const AdaptiveResult & result) { return sum + result.sweeps; });
+        std::cout << "\tUsed " << total << " sweeps instead of " << range.size() * NUM_STEPS << std::endl;
+
+        const std::span<const AdaptiveResult> span = measurements;
+        write_output_csv(span, prefix + std::to_string(lattice_length), "j,sweeps,energy,delta_energy,tau_energy,ess_energy,magnetization,delta_magnetization,tau_magnetization,ess_magnetization,reason");
+    }
+}
+
+/**
+ * Equilibrates lattices at the critical point and labels the same-spin domains at a fixed sweep interval. Writes the
+ * statistics of every sample and the accumulated domain size distribution per lattice size.
+ *
+ * @param prefix The prefix of the output file names.
+ */
+void metropolis_cluster_statistics(const std::string & prefix) {
+    for (const size_t lattice_length : CLUSTER_LATTICE_SIZES) {
+        std::cout << "Analysing domains at the critical point for N = " << lattice_length << std::endl;
+        const TraceSpan span { "cluster_statistics", { { "lattice_length", lattice_length } } };
+
+        Lattice::seed(SEED + lattice_length);
+        Lattice2D lattice = checkerboard_lattice(lattice_length, Critical);
+        const size_t discarded = lattice.equilibrate(EQUILIBRATION_WINDOW, NUM_STEPS);
+
+        std::vector<ClusterStatistics> samples;
+        std::map<size_t, size_t> distribution;
+        SnapshotWriter snapshots { prefix + "Snapshots_" + std::to_string(lattice_length), lattice.configuration().size() };
+        for (const size_t sample : std::views::iota(static_cast<size_t>(1), NUM_CLUSTER_SAMPLES + 1)) {
+            lattice.run(CLUSTER_INTERVAL, [] (const std::span<const LatticeObservable>) {}, CLUSTER_INTERVAL);
+            samples.push_back(analyse_clusters(lattice, discarded + sample * CLUSTER_INTERVAL));
+            snapshots.write(samples.back().sweeps, lattice.configuration());
+            for (const DomainSizeCount & count : samples.back().size_distribution) distribution[count.size] += count.count;
+        }
+        snapshots.close();
+        std::cout << "\tRecorded " << snapshots.size() << " snapshots with " << snapshots.frame_bytes() / snapshots.size() << " bytes per frame against " << lattice.configuration().size() << " bytes of spins" << std::endl;
+
+        const double percolating = static_cast<double>(std::ranges::count_if(samples, &ClusterStatistics::percolating)) / NUM_CLUSTER_SAMPLES;
+        const double largest = std::ranges::fold_left(samples, 0.0, [] (const double sum, const ClusterStatistics & current) { return sum + current.largest_fraction; }) / NUM_CLUSTER_SAMPLES;
+        std::cout << "\tPercolation probability " << percolating << ", mean largest domain fraction " << largest << std::endl;
+
+        const std::span<const ClusterStatistics> span_samples = samples;
+        write_output_csv(span_samples, prefix + "Samples_" + std::to_string(lattice_length), "sweeps,num_domains,largest_fraction,mean_size,percolating");
+
+        std::vector<DomainSizeCount> counts;
+        for (const auto & [size, count] : distribution) counts.push_back({ size, count });
+        const std::span<const DomainSizeCount> span_counts = counts;
+        write_output_csv(span_counts, prefix + "DomainSizes_" + std::to_string(lattice_length), "size,count");
+    }
+}
+
+/**
+ * Estimates the thermal and magnetic exponents at the critical point from a single lattice size with the Monte Carlo
+ * renormalization group. The exact values are y_thermal = 1, i.e. nu = 1, and y_magnetic = 15 / 8.
+ */
+void renormalization_group(const std::string & prefix) {
+    std::cout << "Monte Carlo renormalization group for N = " << MCRG_LATTICE_SIZE << std::endl;
+    const TraceSpan span { "renormalization_group", { { "lattice_length", MCRG_LATTICE_SIZE } } };
+
+    std::vector<size_t> chains (NUM_MCRG_CHAINS);
+    std::iota(chains.begin(), chains.end(), 0);
+
+    std::vector<BlockSpinAnalysis> analyses (NUM_MCRG_CHAINS, BlockSpinAnalysis { MCRG_LATTICE_SIZE, MCRG_LEVELS });
+    std::for_each(std::execution::par, chains.begin(), chains.end(), [&] (const size_t chain) {
+        Lattice::seed(SEED + chain);
+        Lattice2D lattice = checkerboard_lattice(MCRG_LATTICE_SIZE, Critical);
+        lattice.equilibrate(EQUILIBRATION_WINDOW, NUM_STEPS);
+
+        for (size_t sample = 0; sample < NUM_MCRG_SAMPLES; ++sample) {
+            lattice.run(MCRG_INTERVAL, [] (const std::span<const LatticeObservable>) {}, MCRG_INTERVAL);
+            analyses[chain].push(lattice.configuration());
+        }
+    });
+    for (const BlockSpinAnalysis & analysis : analyses | std::views::drop(1)) analyses.front().merge(analysis);
+
+    const std::vector<RenormalizationExponents> exponents = analyses.front().exponents();
+    for (const RenormalizationExponents & level : exponents) {
+        std::cout << "\tLevel " << level.level << ": nu = " << level.nu << " +- " << level.nu_error << ", y_magnetic = " << level.y_magnetic << " +- " << level.y_magnetic_error << std::endl;
+    }
+
+    const std::span<const RenormalizationExponents> span_exponents = exponents;
+    write_output_csv(span_exponents, prefix + std::to_string(MCRG_LATTICE_SIZE), "level,y_thermal,delta_y_thermal,nu,delta_nu,y_magnetic,delta_y_magnetic");
 }
 
 static std::vector<double> sweep_through_inv_j() {
@@ -113,8 +449,15 @@ static std::vector<double> sweep_through_inv_j() {
 
 int main() {
     std::filesystem::create_directory("output");
+    TraceSpan::enable("trace");
 
     calculate_exact_results();
     metropolis_sweep_j(SPONTANEOUS_MAGNETIZATION_J, "6_1_SpontaneousMagnetization_");
     metropolis_sweep_j(sweep_through_inv_j(), "6_2_ScanningJ_");
+    metropolis_anneal_j(sweep_through_inv_j(), "6_3_AnnealedJ_");
+    metropolis_adaptive_j("6_4_AdaptiveJ_");
+    metropolis_error_targeted_j(sweep_through_inv_j(), "6_5_ErrorTargetedJ_");
+    metropolis_cluster_statistics("6_6_Clusters_");
+    n_fold_way_sweep_j(SPONTANEOUS_MAGNETIZATION_J, "6_7_NFoldWayContinuousTime_");
+    renormalization_group("6_8_MCRG_");
 }
\ No newline at end of file
@@ -0,0 +1,110 @@
+#ifndef ADAPTIVE_RESULT_H
+#define ADAPTIVE_RESULT_H
+
+#include <cstddef>
+#include <limits>
+#include <ostream>
+#include <span>
+#include <sstream>
+#include <vector>
+
+/**
+ * The target of an error-targeted run. Runs stop once the autocorrelation-corrected errors of the mean energy and
+ * magnetization per spin are below the targets or the maximum number of sweeps is reached. An infinite target
+ * disables the observable.
+ */
+struct ErrorTarget {
+	/**
+	 * Writes all fields, so runs with different targets get different keys in the result cache.
+	 */
+	friend std::ostream & operator<<(std::ostream & os, const ErrorTarget & rhs) {
+		std::stringstream output;
+		output << rhs.energy << "," << rhs.magnetization << "," << rhs.block_sweeps << "," << rhs.max_sweeps << "," << rhs.absolute_magnetization;
+		return os << output.str();
+	}
+
+	double energy = std::numeric_limits<double>::infinity();
+	double magnetization = std::numeric_limits<double>::infinity();
+
+	/**
+	 * The number of sweeps between two checks of the errors.
+	 */
+	size_t block_sweeps = 1000;
+
+	/**
+	 * The maximum number of sweeps per run.
+	 */
+	size_t max_sweeps = 1000000;
+
+	/**
+	 * Whether the absolute magnetization is measured, which is needed without an external field where the sign of
+	 * the magnetization flips between the two ordered states.
+	 */
+	bool absolute_magnetization = true;
+};
+
+/**
+ * The mean of a correlated time series with its error corrected by the integrated autocorrelation time.
+ */
+struct ObservableEstimate {
+	ObservableEstimate() = default;
+
+	/**
+	 * Estimates the integrated autocorrelation time with the initial monotone sequence estimator of Geyer from the
+	 * autocorrelation function, which is calculated by FFT.
+	 */
+	explicit ObservableEstimate(std::span<const double> series);
+
+	friend std::ostream & operator<<(std::ostream & os, const ObservableEstimate & estimate) {
+		std::stringstream output;
+		output << estimate.mean << "," << estimate.error << "," << estimate.autocorrelation_time << "," << estimate.effective_samples;
+		return os << output.str();
+	}
+
+	/**
+	 * Whether the series is long enough compared to the autocorrelation time for the estimate to be reliable.
+	 */
+	[[nodiscard]] bool reliable(size_t num_samples) const;
+
+	double mean = 0.0, error = 0.0, autocorrelation_time = 0.5, effective_samples = 0.0;
+};
+
+/**
+ * Why an error-targeted run stopped.
+ */
+enum class StopReason { TargetReached, BudgetExhausted };
+
+/**
+ * The result of an error-targeted run for a single parameter point.
+ */
+struct AdaptiveResult {
+	AdaptiveResult() = default;
+	explicit AdaptiveResult(double parameter, size_t sweeps, ObservableEstimate energy, ObservableEstimate magnetization, StopReason reason);
+
+	/**
+	 * Restores a result from its serialized values, e.g. from the result cache.
+	 */
+	explicit AdaptiveResult(std::span<const double> values);
+
+	/**
+	 * Serializes the result into values for the result cache.
+	 */
+	[[nodiscard]] std::vector<double> serialize() const;
+
+	friend std::ostream & operator<<(std::ostream & os, const AdaptiveResult & result) {
+		std::stringstream output;
+		output << result.parameter << "," << result.sweeps << "," << result.energy << "," << result.magnetization << ","
+			<< (result.reason == StopReason::TargetReached ? "target" : "budget");
+		return os << output.str();
+	}
+
+	/**
+	 * The scanned parameter, e.g. the coupling constant or the magnetic field strength.
+	 */
+	double parameter = 0.0;
+	size_t sweeps = 0;
+	ObservableEstimate energy, magnetization;
+	StopReason reason = StopReason::BudgetExhausted;
+};
+
+#endif //ADAPTIVE_RESULT_H
@@ -0,0 +1,252 @@
+#ifndef ASYNC_WRITER_H
+#define ASYNC_WRITER_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <span>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <tbb/concurrent_queue.h>
+
+#include "trace.h"
+
+/**
+ * Writes rows to a CSV file on two long-lived threads. Simulation threads push fixed-size batches into a bounded
+ * tbb::concurrent_bounded_queue, which blocks the pushing thread while it is full, so peak memory is bounded by the
+ * queue capacity independent of the length of the run. The formatting thread formats the batches into one buffer while
+ * the flushing thread writes the previous buffer to the file, after which the buffers are swapped, so formatting never
+ * waits for the file unless it outpaces the disk.
+ *
+ * The rows are grouped into sections, e.g. one per parameter point, which are written contiguously in the order of
+ * their indices even if several threads push to different sections at once. The rows of the first unfinished section
+ * go straight to the file, the rows of later sections are spilled to temporary files until all sections before them
+ * are finished. Only the spill files of the sections which are still being pushed stay open.
+ */
+template<typename T>
+class AsyncCsvWriter {
+public:
+	/**
+	 * Opens the output file, writes the headers and starts the formatting and flushing threads.
+	 *
+	 * @param file_name The name of the CSV file in the output directory.
+	 * @param headers The header line of the CSV file.
+	 * @param batch_size The number of rows per batch.
+	 * @param capacity The maximum number of batches waiting in the queue before push blocks.
+	 */
+	AsyncCsvWriter(const std::string & file_name, const std::string & headers, const size_t batch_size = 1024, const size_t capacity = 64)
+		: path("output/" + file_name + ".csv"), batch_size(batch_size) {
+		output.open(path);
+		output << headers << "\n";
+
+		batches.set_capacity(static_cast<std::ptrdiff_t>(capacity));
+		chunks.set_capacity(1);
+		written.set_capacity(2);
+		flusher = std::thread(&AsyncCsvWriter::flush_loop, this);
+		writer = std::thread(&AsyncCsvWriter::write_loop, this);
+	}
+
+	AsyncCsvWriter(const AsyncCsvWriter &) = delete;
+	AsyncCsvWriter & operator=(const AsyncCsvWriter &) = delete;
+
+	~AsyncCsvWriter() {
+		close();
+	}
+
+	/**
+	 * Splits the rows into batches and enqueues them for writing to the given section. Blocks while the queue is full.
+	 * Rows of a section must be pushed by one thread at a time and are written in order.
+	 */
+	void push(const size_t section, const std::span<const T> rows) {
+		const TraceSpan span { "csv_push", { { "rows", rows.size() } } };
+		for (size_t i = 0; i < rows.size(); i += batch_size) {
+			const std::span<const T> batch = rows.subspan(i, std::min(batch_size, rows.size() - i));
+			batches.push({ Batch::Kind::Rows, section, std::vector<T>(batch.begin(), batch.end()) });
+		}
+	}
+
+	/**
+	 * Enqueues the rows for writing to the first section, for writers with a single producer.
+	 */
+	void push(const std::span<const T> rows) {
+		push(0, rows);
+	}
+
+	/**
+	 * Marks the section as complete, no rows may be pushed to it afterwards.
+	 */
+	void finish(const size_t section) {
+		batches.push({ Batch::Kind::Finish, section, {} });
+	}
+
+	/**
+	 * Writes all remaining batches, stops the threads and closes the file. Unfinished sections are written in the order
+	 * of their indices.
+	 */
+	void close() {
+		if (!writer.joinable()) return;
+		batches.push({ Batch::Kind::Close, 0, {} });
+		writer.join();
+		flusher.join();
+		output.close();
+	}
+
+private:
+	/**
+	 * A message to the writer thread.
+	 */
+	struct Batch {
+		enum class Kind { Rows, Finish, Close } kind = Kind::Close;
+		size_t section = 0;
+		std::vector<T> rows;
+	};
+
+	/**
+	 * A piece of the file handed from the formatting to the flushing thread, either a formatted buffer or the path of a
+	 * spill file whose contents are copied and which is removed afterwards.
+	 */
+	struct Chunk {
+		enum class Kind { Buffer, Spill, Close } kind = Kind::Close;
+		std::string data;
+	};
+
+	/**
+	 * The rows of a section which is not the first unfinished section yet.
+	 */
+	struct Spill {
+		std::string path;
+		std::ofstream file;
+		bool finished = false;
+	};
+
+	/**
+	 * The size of the formatted buffer after which it is written to the file.
+	 */
+	static constexpr size_t FLUSH_SIZE = 1 << 20;
+
+	/**
+	 * Pops and formats batches until the close message arrives.
+	 */
+	void write_loop() {
+		std::string buffer;
+		std::ostringstream row;
+		std::map<size_t, Spill> spills;
+		size_t head = 0;
+
+		// Hands the buffer to the flushing thread and continues with the buffer it has written before.
+		const auto flush = [&] {
+			if (buffer.empty()) return;
+			chunks.push({ Chunk::Kind::Buffer, std::move(buffer) });
+			if (!written.try_pop(buffer)) buffer = {};
+			buffer.clear();
+		};
+
+		const auto spill = [&] (const size_t section) -> Spill & {
+			Spill & spilled = spills[section];
+			if (!spilled.file.is_open()) {
+				spilled.path = path + "." + std::to_string(section) + ".tmp";
+				spilled.file.open(spilled.path);
+			}
+			return spilled;
+		};
+
+		// Copies the spilled rows of the section at the head to the file. Returns whether the section was finished.
+		const auto drain = [&] (const auto entry) {
+			flush();
+			Spill & spilled = entry->second;
+			if (spilled.file.is_open()) spilled.file.close();
+			chunks.push({ Chunk::Kind::Spill, std::move(spilled.path) });
+
+			const bool finished = spilled.finished;
+			spills.erase(entry);
+			return finished;
+		};
+
+		Batch batch;
+		while (true) {
+			batches.pop(batch);
+			if (batch.kind == Batch::Kind::Close) break;
+			assert(batch.section >= head);
+
+			if (batch.kind == Batch::Kind::Rows) {
+				for (const T & value : batch.rows) {
+					row.str({});
+					row << value << "\n";
+					if (batch.section == head) {
+						buffer += row.view();
+					} else {
+						spill(batch.section).file << row.view();
+					}
+				}
+				if (buffer.size() >= FLUSH_SIZE) flush();
+				continue;
+			}
+
+			if (batch.section != head) {
+				Spill & spilled = spill(batch.section);
+				spilled.file.close();
+				spilled.finished = true;
+				continue;
+			}
+			head += 1;
+			while (true) {
+				const auto entry = spills.find(head);
+				if (entry == spills.end() || !drain(entry)) break;
+				head += 1;
+			}
+		}
+
+		while (!spills.empty()) drain(spills.begin());
+		flush();
+		chunks.push({ Chunk::Kind::Close, {} });
+	}
+
+	/**
+	 * Writes the chunks to the file in the order they were handed over until the close message arrives and returns the
+	 * written buffers to the formatting thread.
+	 */
+	void flush_loop() {
+		Chunk chunk;
+		while (true) {
+			chunks.pop(chunk);
+			if (chunk.kind == Chunk::Kind::Close) break;
+
+			if (chunk.kind == Chunk::Kind::Buffer) {
+				const TraceSpan span { "csv_flush", { { "bytes", chunk.data.size() } } };
+				output.write(chunk.data.data(), static_cast<std::streamsize>(chunk.data.size()));
+				written.try_push(std::move(chunk.data));
+				continue;
+			}
+
+			const TraceSpan span { "csv_drain" };
+			{
+				std::ifstream input (chunk.data);
+				output << input.rdbuf();
+			}
+			std::remove(chunk.data.c_str());
+		}
+		output.flush();
+	}
+
+	const std::string path;
+	const size_t batch_size;
+
+	std::ofstream output;
+	tbb::concurrent_bounded_queue<Batch> batches;
+
+	/**
+	 * The chunk waiting for the flushing thread and the buffers it has written, which are reused for formatting.
+	 */
+	tbb::concurrent_bounded_queue<Chunk> chunks;
+	tbb::concurrent_bounded_queue<std::string> written;
+
+	std::thread writer, flusher;
+};
+
+#endif //ASYNC_WRITER_H
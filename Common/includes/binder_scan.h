@@ -0,0 +1,117 @@
+#ifndef BINDER_SCAN_H
+#define BINDER_SCAN_H
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <span>
+#include <sstream>
+#include <vector>
+
+/**
+ * The Binder cumulant and susceptibility at a single coupling constant j and lattice size, estimated from a history of
+ * magnetizations per spin. The uncertainties are jackknife estimates over blocks of the history, which accounts for
+ * the autocorrelation as long as the blocks are longer than the autocorrelation time.
+ */
+struct BinderPoint {
+	BinderPoint() = default;
+
+	/**
+	 * Estimates the moments from the magnetizations per spin.
+	 *
+	 * @param lattice_length The side length of the simulated lattice.
+	 * @param beta The inverse temperature.
+	 * @param j The coupling constant j.
+	 * @param magnetizations The history of magnetizations per spin.
+	 * @param num_blocks The number of blocks for the jackknife.
+	 */
+	BinderPoint(size_t lattice_length, double beta, double j, std::span<const double> magnetizations, size_t num_blocks = 16);
+
+	friend std::ostream & operator<<(std::ostream & os, const BinderPoint & point) {
+		std::stringstream output;
+		output << point.j << "," << point.samples << "," << point.binder << "," << point.binder_error << "," << point.susceptibility << "," << point.susceptibility_error;
+		return os << output.str();
+	}
+
+	size_t lattice_length = 0;
+	double j = 0.0;
+	size_t samples = 0;
+	double binder = 0.0, binder_error = 0.0, susceptibility = 0.0, susceptibility_error = 0.0;
+};
+
+/**
+ * The coupling constant j at which the Binder cumulants of two lattice sizes cross, together with its uncertainty.
+ */
+struct BinderCrossing {
+	size_t smaller, larger;
+	double j, uncertainty;
+};
+
+/**
+ * Scans the coupling constant j for several lattice sizes on a common grid which is refined adaptively. Starting from a
+ * coarse grid, every round adds the midpoints of the intervals in which the Binder cumulants of consecutive lattice
+ * sizes cross and of the intervals next to the susceptibility peaks, until these intervals are narrower than the
+ * target precision or their end points agree within the statistical uncertainty. The sweep budget is thus only spent
+ * close to the critical point.
+ */
+class BinderScan {
+public:
+	/**
+	 * Returns the history of magnetizations per spin of an equilibrated lattice with the given size and j.
+	 */
+	using Measure = std::function<std::vector<double>(size_t lattice_length, double j)>;
+
+	/**
+	 * @param lattice_sizes The side lengths of the lattices in ascending order.
+	 * @param beta The inverse temperature.
+	 * @param grid The coarse grid of coupling constants to start from.
+	 * @param measure Simulates a single lattice size and coupling constant. Called concurrently.
+	 */
+	BinderScan(std::vector<size_t> lattice_sizes, double beta, std::vector<double> grid, Measure measure);
+
+	/**
+	 * Refines the grid until every crossing is bracketed more narrowly than the tolerance, cannot be resolved further
+	 * or the maximum number of rounds is reached. Returns the crossings of the Binder cumulants of consecutive lattice sizes.
+	 *
+	 * @param tolerance The target precision on the crossing coupling constants.
+	 * @param max_rounds The maximum number of refinement rounds.
+	 * @return The crossings of the final grid.
+	 */
+	std::vector<BinderCrossing> refine(double tolerance, size_t max_rounds);
+
+	/**
+	 * Locates the crossings of the Binder cumulants of consecutive lattice sizes on the current grid by linear
+	 * interpolation.
+	 */
+	[[nodiscard]] std::vector<BinderCrossing> crossings() const;
+
+	/**
+	 * Returns the points of the given lattice size in ascending order of j.
+	 */
+	[[nodiscard]] std::vector<BinderPoint> points(size_t lattice_length) const;
+
+private:
+	/**
+	 * Simulates all points of the grid which have not been simulated yet.
+	 */
+	void measure_missing();
+
+	/**
+	 * Returns the midpoints of the intervals which bracket a crossing or a susceptibility peak and are wider than the
+	 * tolerance.
+	 */
+	[[nodiscard]] std::vector<double> candidates(double tolerance) const;
+
+	std::vector<size_t> lattice_sizes;
+	double beta;
+	std::vector<double> grid;
+	Measure measure;
+
+	/**
+	 * The simulated points keyed by lattice size and j.
+	 */
+	std::map<std::pair<size_t, double>, BinderPoint> results;
+};
+
+#endif //BINDER_SCAN_H
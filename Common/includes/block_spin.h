@@ -0,0 +1,117 @@
+#ifndef BLOCK_SPIN_H
+#define BLOCK_SPIN_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <sstream>
+#include <vector>
+
+/**
+ * Applies the majority rule to every b x b block of a periodic square lattice in row-major order. A tie in a block of
+ * even size is broken by the spin in the upper left corner of the block. For b = 2 the rows are packed into 64-bit
+ * words and 32 blocks are decided at once with bitwise operations.
+ *
+ * @param spins The spins of the lattice.
+ * @param lattice_length The side length of the lattice, must be a multiple of the block size.
+ * @param block_size The side length b of the blocks.
+ * @return The block spins of the lattice with side length lattice_length / b.
+ */
+std::vector<int8_t> block_spins(std::span<const int8_t> spins, size_t lattice_length, size_t block_size = 2);
+
+/**
+ * The eigenvalue exponents of the linearized renormalization group transformation from one blocking level to the next,
+ * with jackknife uncertainties. The correlation length exponent is nu = 1 / y_thermal.
+ */
+struct RenormalizationExponents {
+	friend std::ostream & operator<<(std::ostream & os, const RenormalizationExponents & rhs) {
+		std::stringstream output;
+		output << rhs.level << "," << rhs.y_thermal << "," << rhs.y_thermal_error << "," << rhs.nu << "," << rhs.nu_error << "," << rhs.y_magnetic << "," << rhs.y_magnetic_error;
+		return os << output.str();
+	}
+
+	size_t level = 0;
+	double y_thermal = 0.0, y_thermal_error = 0.0, nu = 0.0, nu_error = 0.0, y_magnetic = 0.0, y_magnetic_error = 0.0;
+};
+
+/**
+ * Monte Carlo renormalization group analysis after Swendsen. Every configuration is blocked repeatedly with the majority
+ * rule and a set of even and odd spin operators S is measured on every level n. The linearized transformation of the
+ * couplings from level n to n + 1 follows from the correlation matrices as
+ *
+ *     T = B^-1 A,  A = <S(n + 1) S(n)> - <S(n + 1)> <S(n)>,  B = <S(n + 1) S(n + 1)> - <S(n + 1)> <S(n + 1)>,
+ *
+ * and the leading eigenvalues lambda of its even and odd parts give the exponents y = ln lambda / ln b. At the critical
+ * point the estimates converge with the level and the number of operators, so a single large lattice yields the
+ * exponents without finite-size scaling over many lattice sizes. The odd operators vanish by symmetry, so their
+ * averages are not subtracted, which keeps the estimates independent of the rare global spin flips.
+ */
+class BlockSpinAnalysis {
+public:
+	/**
+	 * The even operators are the nearest neighbour, diagonal and third neighbour products and the plaquette product.
+	 */
+	static constexpr size_t NUM_EVEN = 4;
+
+	/**
+	 * The odd operators are the magnetization and the products of the three spins at the corners of the plaquettes.
+	 */
+	static constexpr size_t NUM_ODD = 2;
+
+	/**
+	 * @param lattice_length The side length of the simulated lattice.
+	 * @param levels The number of blocking transformations, the blocked lattices must be at least 4 x 4.
+	 * @param block_size The side length b of the blocks.
+	 */
+	BlockSpinAnalysis(size_t lattice_length, size_t levels, size_t block_size = 2);
+
+	/**
+	 * Blocks the configuration and records the operators of all levels.
+	 */
+	void push(std::span<const int8_t> spins);
+
+	/**
+	 * Appends the measurements of another analysis of the same lattice, e.g. of an independent chain.
+	 */
+	void merge(const BlockSpinAnalysis & other);
+
+	/**
+	 * Returns the number of recorded configurations.
+	 */
+	[[nodiscard]] size_t size() const noexcept;
+
+	/**
+	 * Estimates the exponents for every blocking level with jackknife uncertainties over blocks of the measurements,
+	 * which must be longer than the autocorrelation time.
+	 *
+	 * @param num_blocks The number of blocks for the jackknife.
+	 */
+	[[nodiscard]] std::vector<RenormalizationExponents> exponents(size_t num_blocks = 16) const;
+
+private:
+	static constexpr size_t NUM_OPERATORS = NUM_EVEN + NUM_ODD;
+
+	using Operators = std::array<double, NUM_OPERATORS>;
+
+	/**
+	 * Measures the operators on a lattice in row-major order.
+	 */
+	static Operators measure(std::span<const int8_t> spins, size_t lattice_length);
+
+	/**
+	 * Estimates the thermal and magnetic exponents of the transformation from the given level to the next, leaving out
+	 * the measurements [skip_begin, skip_end) for the jackknife.
+	 */
+	[[nodiscard]] std::array<double, 2> estimate(size_t level, size_t skip_begin, size_t skip_end) const;
+
+	size_t lattice_length, levels, block_size;
+
+	/**
+	 * The operators of every level of every configuration, levels + 1 entries per configuration.
+	 */
+	std::vector<Operators> operators;
+};
+
+#endif //BLOCK_SPIN_H
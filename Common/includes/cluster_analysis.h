@@ -0,0 +1,72 @@
+#ifndef CLUSTER_ANALYSIS_H
+#define CLUSTER_ANALYSIS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <sstream>
+#include <vector>
+
+#include "lattice_2d.h"
+
+/**
+ * The number of domains of a given size, intended to be used for serializing the domain size distribution.
+ */
+struct DomainSizeCount {
+	friend std::ostream & operator<<(std::ostream & os, const DomainSizeCount & count) {
+		std::stringstream output;
+		output << count.size << "," << count.count;
+		return os << output.str();
+	}
+
+	size_t size, count;
+};
+
+/**
+ * The statistics of the same-spin domains of a single configuration. The mean domain size excludes the largest
+ * domain, as usual in percolation theory.
+ */
+struct ClusterStatistics {
+	friend std::ostream & operator<<(std::ostream & os, const ClusterStatistics & statistics) {
+		std::stringstream output;
+		output << statistics.sweeps << "," << statistics.num_domains << "," << statistics.largest_fraction << "," << statistics.mean_size << "," << statistics.percolating;
+		return os << output.str();
+	}
+
+	size_t sweeps = 0, num_domains = 0, largest = 0;
+	double largest_fraction = 0.0, mean_size = 0.0;
+
+	/**
+	 * Whether the largest domain wraps around the periodic lattice, i.e. contains a closed path which winds around the
+	 * torus in at least one direction.
+	 */
+	bool percolating = false;
+
+	/**
+	 * The number of domains per domain size in ascending order of size.
+	 */
+	std::vector<DomainSizeCount> size_distribution;
+};
+
+/**
+ * Labels the same-spin domains of a periodic square lattice in row-major order with union-find in the spirit of
+ * Hoshen-Kopelman. The rows are split into stripes which are labelled in parallel, only touching sites of their own
+ * stripe, after which a single pass merges the domains across the stripe boundaries. Union by size with path
+ * compression keeps the trees flat and yields the domain sizes at the roots. Every site also stores its displacement
+ * relative to its parent, from which a domain is detected to wrap around the torus when a bond closes a loop with
+ * non-zero winding. The analysis takes O(N alpha(N)) time and four words per site.
+ *
+ * @param spins The spins in row-major order.
+ * @param lattice_length The side length of the lattice.
+ * @param spin Only domains of this spin are reported, or domains of both spins if zero.
+ * @return The domain statistics.
+ */
+ClusterStatistics analyse_clusters(std::span<const int8_t> spins, size_t lattice_length, int8_t spin = 0);
+
+/**
+ * Analyses the domains of the current configuration of the lattice.
+ */
+ClusterStatistics analyse_clusters(const Lattice2D & lattice, size_t sweeps, int8_t spin = 0);
+
+#endif //CLUSTER_ANALYSIS_H
@@ -0,0 +1,109 @@
+#ifndef DISTRIBUTION_H
+#define DISTRIBUTION_H
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <sstream>
+#include <vector>
+
+#include "histogram.h"
+
+/**
+ * A single point of a probability density, intended to be used for serializing to a CSV file.
+ */
+struct DistributionPoint {
+	friend std::ostream & operator<<(std::ostream & os, const DistributionPoint & point) {
+		std::stringstream output;
+		output << point.x << "," << point.density;
+		return os << output.str();
+	}
+
+	double x, density;
+};
+
+/**
+ * A probability distribution discretized to point masses on the equidistant grid origin + k * step. The distribution
+ * of the sum of two independent variables is the convolution of their distributions, which is calculated exactly up
+ * to rounding by FFT. Masses which are negligible compared to the largest mass are trimmed from both tails, so the
+ * support only grows with the width of the distribution.
+ */
+class DiscreteDistribution {
+public:
+	/**
+	 * Discretizes the probability density on [lower, upper] into the given number of grid points and normalizes the
+	 * masses.
+	 */
+	static DiscreteDistribution from_pdf(const std::function<double(double)> & pdf, double lower, double upper, size_t points);
+
+	/**
+	 * Returns the distribution of the sum of a variable of this and an independent variable of the other
+	 * distribution. Both distributions must have the same step.
+	 */
+	[[nodiscard]] DiscreteDistribution convolve(const DiscreteDistribution & other) const;
+
+	/**
+	 * Returns the distribution of the sum of n independent variables of this distribution by exponentiation by
+	 * squaring, which takes O(M log M log n) operations for M grid points.
+	 */
+	[[nodiscard]] DiscreteDistribution power(size_t n) const;
+
+	/**
+	 * Returns the distribution of the variable multiplied by the positive factor.
+	 */
+	[[nodiscard]] DiscreteDistribution scaled(double factor) const;
+
+	/**
+	 * Calculates the k-th moment about the origin.
+	 */
+	[[nodiscard]] double moment(size_t k) const;
+
+	/**
+	 * Calculates the k-th moment about the mean.
+	 */
+	[[nodiscard]] double central_moment(size_t k) const;
+
+	/**
+	 * Calculates the k-th cumulant for k = 1 to 4 from the central moments.
+	 */
+	[[nodiscard]] double cumulant(size_t k) const;
+
+	/**
+	 * Calculates the moment generating function E[exp(t X)].
+	 */
+	[[nodiscard]] double moment_generating(double t) const;
+
+	/**
+	 * Calculates the cumulant generating function log E[exp(t X)]. Only reliable as long as the exponentially tilted
+	 * distribution lies within the retained support, for sums of n variables prefer n times the cumulant generating
+	 * function of a single variable.
+	 */
+	[[nodiscard]] double cumulant_generating(double t) const;
+
+	/**
+	 * Returns the probability density at every grid point.
+	 */
+	[[nodiscard]] std::vector<DistributionPoint> density() const;
+
+private:
+	DiscreteDistribution(double origin, double step, std::vector<double> masses);
+
+	/**
+	 * Removes the negligible masses from both tails and renormalizes.
+	 */
+	void trim();
+
+	double origin, step;
+	std::vector<double> masses;
+};
+
+/**
+ * Samples the mean of num_terms independent variables num_experiments times in parallel and counts the means which
+ * fall into [lower, upper) in a histogram.
+ *
+ * @param sample Draws a single variable. Called concurrently.
+ * @return The histogram of the means mapped onto [0, 1).
+ */
+histogram::Histogram sample_means(const std::function<double()> & sample, size_t num_terms, size_t num_experiments, double lower, double upper, size_t bins);
+
+#endif //DISTRIBUTION_H
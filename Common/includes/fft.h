@@ -0,0 +1,36 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <complex>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+/**
+ * Transforms the data in place with the iterative radix-2 Cooley-Tukey algorithm. The size of the data must be a
+ * power of two. The inverse transform includes the normalization by the size.
+ *
+ * @param data The data to be transformed.
+ * @param inverse Whether to calculate the inverse transform.
+ */
+void fft(std::span<std::complex<double>> data, bool inverse = false);
+
+/**
+ * Transforms row-major data of the given number of rows in place by transforming all rows and then all columns. Both
+ * dimensions must be powers of two, the inverse transform includes the normalization by the size.
+ *
+ * @param data The data to be transformed.
+ * @param rows The number of rows.
+ * @param inverse Whether to calculate the inverse transform.
+ */
+void fft_2d(std::span<std::complex<double>> data, size_t rows, bool inverse = false);
+
+/**
+ * Calculates the linear convolution of two real sequences by multiplying their transforms, which takes
+ * O(M log M) instead of O(M^2) operations.
+ *
+ * @return The convolution with lhs.size() + rhs.size() - 1 elements.
+ */
+std::vector<double> convolve(std::span<const double> lhs, std::span<const double> rhs);
+
+#endif //FFT_H
@@ -2,14 +2,22 @@
 #define LATTICE_H
 
 #include <cstddef>
-#include <generator>
+#include <cstdint>
+#include <span>
+#include <vector>
 
+#include "adaptive_result.h"
 #include "lattice_observable.h"
+#include "sweep_driver.h"
 
 /**
  * Represents a generic lattice and declares all methods needed for Metroplis-Hastings Monte Carlo methods.
+ * The state is tracked as the integer bond sum and spin sum, so energies are exact integer multiples of j and
+ * conversion to physical units only happens when observables are reported.
  */
-class Lattice {
+class Lattice : public SweepDriver<Lattice> {
+	friend class SweepDriver<Lattice>;
+
 public:
 	/**
 	 * Instantiates a new lattice with the given coupling constant j and magnetic field strength h
@@ -29,36 +37,76 @@ public:
     [[nodiscard]] virtual constexpr size_t num_sites() const noexcept = 0;
 
 
+	/**
+	 * Returns the largest number of neighbours of any site, which bounds the bond sum difference of a single flip.
+	 */
+    [[nodiscard]] virtual int coordination() const noexcept = 0;
+
+
+	/**
+	 * Calculates the sum of the products of neighbouring spins over all bonds.
+	 */
+    [[nodiscard]] virtual int64_t bond_sum() const = 0;
+
+	/**
+	 * Calculates the bond sum difference if one was to flip the spin at index i.
+	 */
+    [[nodiscard]] virtual int bond_sum_diff(size_t i) const = 0;
+
+
+	/**
+	 * Calculates the sum of all spins.
+	 */
+    [[nodiscard]] virtual int64_t spin_sum() const = 0;
+
+	/**
+	 * Calculates the spin sum difference if one was to flip the spin at index i.
+	 */
+    [[nodiscard]] virtual int spin_sum_diff(size_t i) const = 0;
+
+	/**
+	 * Calculates the spin sum difference weighted by the field at index i if one was to flip the spin, which is the
+	 * spin sum difference unless the field varies between the sites.
+	 */
+    [[nodiscard]] virtual int field_sum_diff(size_t i) const;
+
+
+	/**
+	 * Flips the spin at index i and keeps the bond and spin sums of the observables up to date. Allows other dynamics
+	 * than the sweeps to change the configuration.
+	 */
+	void flip(size_t i);
+
+
 	/**
 	 * Calculates the total energy of the lattice.
 	 */
-    [[nodiscard]] virtual double energy() const = 0;
+    [[nodiscard]] double energy() const;
 
 	/**
 	 * Calculates the energy difference if one was to flip the spin at index i.
 	 */
-    [[nodiscard]] virtual double energy_diff(size_t i) const = 0;
-
+    [[nodiscard]] double energy_diff(size_t i) const;
 
 	/**
 	 * Calculates the total magnetization of the lattice.
 	 */
-    [[nodiscard]] virtual double magnetization() const = 0;
+    [[nodiscard]] double magnetization() const;
 
 	/**
 	 * Calculates the magnetization difference if one was to flip the spin at index i.
 	 */
-    [[nodiscard]] virtual double magnetization_diff(size_t i) const = 0;
+    [[nodiscard]] double magnetization_diff(size_t i) const;
 
 	/**
 	 * Calculates the total action of the lattice.
 	 */
-    [[nodiscard]] double action() const;
+    [[nodiscard]] virtual double action() const;
 
 	/**
 	 * Calculates the action difference if one was to flip the spin at index i.
 	 */
-    [[nodiscard]] double action_diff(size_t i) const;
+    [[nodiscard]] virtual double action_diff(size_t i) const;
 
 	/**
 	 * Calculates the action difference given the difference of energy and magnetization.
@@ -66,40 +114,100 @@ public:
 	[[nodiscard]] double action_diff(double diff_energy, double diff_magnetization) const;
 
 	/**
-	 * Calculates the acceptance probability if one was to flip the spin at index i.
+	 * Calculates the acceptance probability if one was to flip the spin at index i, including the field at the site.
 	 */
     [[nodiscard]] double acceptance(size_t i) const noexcept;
 
 	/**
-	 * Calculates the acceptance probability given the difference of energy and magnetization
+	 * Looks up the acceptance probability given the difference of the bond sum and the difference of the spin sum
+	 * weighted by the field at the flipped site, which is one of -2, 0 or +2.
 	 */
-	[[nodiscard]] double acceptance(double diff_energy, double diff_magnetization) const;
+	[[nodiscard]] double acceptance(int diff_bonds, int diff_field) const noexcept;
 
 	/**
-	 * Performs a single lattice sweep and calculates the acceptance ratio for every lattice site and flips
-	 * the spin of the site if the acceptance ration is greater than a random number [0, 1].
+	 * Looks up the integer threshold of the acceptance probability, a flip is accepted if a raw random number of the
+	 * RandomBuffer is below it.
 	 */
-	std::generator<LatticeObservable> sweeps();
+	[[nodiscard]] uint64_t threshold(int diff_bonds, int diff_field) const noexcept;
+
+	/**
+	 * Returns the current observables in physical units.
+	 */
+	[[nodiscard]] LatticeObservable observable() const;
 
 	/**
 	 * Performs the metropolis hastings simulation with the given number of sweeps for a given
-	 * external magnetic field h. Returns the mean observable values per spin.
+	 * external magnetic field h. Returns the mean observable values per spin. Accumulates the integer sums directly
+	 * instead of going through the observables of run.
 	 *
 	 * @param num_sweeps The number of sweeps made in total.
 	 * @return The mean observable values.
 	 */
 	LatticeObservable metropolis_hastings(size_t num_sweeps);
 
+	/**
+	 * Sweeps in blocks until the autocorrelation-corrected errors of the mean energy and magnetization per spin fall
+	 * below the target or the maximum number of sweeps is reached. The lattice should be equilibrated.
+	 *
+	 * @param parameter The scanned parameter which is stored in the result.
+	 * @param target The error targets and sweep budget.
+	 * @return The estimates, the number of sweeps and why the run stopped.
+	 */
+	AdaptiveResult run_until(double parameter, const ErrorTarget & target);
+
+	/**
+	 * Changes the inverse temperature, coupling constant j and magnetic field strength h while keeping the current
+	 * spin configuration. Allows carrying an equilibrated lattice from one parameter point of a scan to the next.
+	 */
+	void anneal(double beta, double j, double h);
+
+	/**
+	 * Sweeps the lattice in windows until the mean energy and magnetization of two consecutive windows agree within
+	 * their uncertainties, which are corrected by the integrated autocorrelation times of the windows. Returns the
+	 * number of sweeps which were discarded as thermalization.
+	 *
+	 * @param window The number of sweeps per window.
+	 * @param max_sweeps The maximum number of sweeps which may be discarded.
+	 * @return The number of discarded sweeps.
+	 */
+	size_t equilibrate(size_t window, size_t max_sweeps);
+
 protected:
+	/**
+	 * Calculates the bond and spin sums of the initial configuration and the acceptance table. Must be called by the
+	 * constructors of the implementations once the spins are set up.
+	 */
+	void initialize();
+
+	/**
+	 * Tabulates the acceptance probabilities for every possible difference of bond sum and field weighted spin sum.
+	 */
+	void update_acceptances();
+
+	/**
+	 * Performs a single lattice sweep and calculates the acceptance ratio for every lattice site and flips
+	 * the spin of the site if a raw random number is below the threshold of the acceptance ratio.
+	 */
+	virtual void sweep();
+
 	/**
 	 * The inverse temperature, coupling constant j and the magnetic field strength h.
 	 */
     double beta, j, h;
 
 	/**
-	 * The current observable values
+	 * The number of sweeps made and the current bond and spin sums.
+	 */
+	size_t current_sweeps = 0;
+	int64_t current_bonds = 0, current_spins = 0;
+
+	/**
+	 * The acceptance probabilities and their integer thresholds indexed by the bond sum difference and the field
+	 * weighted spin sum difference.
 	 */
-	LatticeObservable current;
+	int max_diff_bonds = 0;
+	std::vector<double> acceptances;
+	std::vector<uint64_t> thresholds;
 };
 
 #endif //LATTICE_H
@@ -7,19 +7,20 @@
 class Lattice1D final : public Lattice {
 public:
     Lattice1D(const size_t lattice_size, const double beta, const double j, const double h) : Lattice(beta, j, h), spins(lattice_size, 1) {
-	    current = LatticeObservable(0, j, energy(), magnetization());
+	    initialize();
     }
 
 	void flip_spin(size_t i) override;
 	[[nodiscard]] constexpr size_t num_sites() const noexcept override;
+	[[nodiscard]] int coordination() const noexcept override;
 
-	[[nodiscard]] double energy() const override;
-	[[nodiscard]] double energy_diff(size_t i) const override;
+	[[nodiscard]] int64_t bond_sum() const override;
+	[[nodiscard]] int bond_sum_diff(size_t i) const override;
 
-	[[nodiscard]] double magnetization() const override;
-	[[nodiscard]] double magnetization_diff(size_t i) const override;
+	[[nodiscard]] int64_t spin_sum() const override;
+	[[nodiscard]] int spin_sum_diff(size_t i) const override;
 
-	static double magnetization_diff(int8_t old_spin);
+	static int spin_sum_diff(int8_t old_spin);
 
 private:
     std::vector<int8_t> spins;
@@ -4,28 +4,40 @@
 #include <cmath>
 #include <iostream>
 #include <lattice.h>
+#include <span>
 #include <vector>
 
 class Lattice2D final : public Lattice {
 public:
 	Lattice2D(const size_t lattice_length, const double beta, const double j, const double h) : Lattice(beta, j, h), lattice_length(lattice_length), spins(lattice_length * lattice_length, 1) {
-	    current = LatticeObservable(0, j, energy(), magnetization());
+	    initialize();
 	}
 
 	Lattice2D(const double beta, const double j, const double h, std::vector<int8_t> & spins) : Lattice(beta, j, h), lattice_length(static_cast<size_t>(std::sqrt(spins.size()))), spins(std::move(spins)) {
-		current = LatticeObservable(0, j, energy(), magnetization());
+		initialize();
 	}
 
 	void flip_spin(size_t i) override;
 	[[nodiscard]] constexpr size_t num_sites() const noexcept override;
+	[[nodiscard]] int coordination() const noexcept override;
 
-	[[nodiscard]] double energy() const override;
-	[[nodiscard]] double energy_diff(size_t i) const override;
+	[[nodiscard]] int64_t bond_sum() const override;
+	[[nodiscard]] int bond_sum_diff(size_t i) const override;
 
-	[[nodiscard]] double magnetization() const override;
-	[[nodiscard]] double magnetization_diff(size_t i) const override;
+	[[nodiscard]] int64_t spin_sum() const override;
+	[[nodiscard]] int spin_sum_diff(size_t i) const override;
 
-	static double magnetization_diff(int8_t old_spin);
+	static int spin_sum_diff(int8_t old_spin);
+
+	/**
+	 * Returns the side length of the lattice.
+	 */
+	[[nodiscard]] size_t length() const noexcept;
+
+	/**
+	 * Returns the spins in row-major order for analyses of the configuration.
+	 */
+	[[nodiscard]] std::span<const int8_t> configuration() const noexcept;
 
 private:
 	const size_t lattice_length;
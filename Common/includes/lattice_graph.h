@@ -0,0 +1,125 @@
+#ifndef LATTICE_GRAPH_H
+#define LATTICE_GRAPH_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <lattice.h>
+#include <random_buffer.h>
+
+/**
+ * A single bond of an interaction graph with its coupling in units of j.
+ */
+struct Bond {
+	uint32_t first, second;
+	int8_t coupling;
+};
+
+/**
+ * Ising model on an arbitrary interaction graph stored as a CSR neighbour list with integer per-bond couplings in
+ * units of j and optional per-site field signs in units of h. Covers Edwards-Anderson spin glasses, diluted lattices
+ * and random-field models. The couplings are restricted to integer multiples of j and the fields to the signs of h, so
+ * the bond and field sums stay integers and the acceptances stay tabulated like on the regular lattices. The bimodal
+ * +-J spin glass and the bimodal random-field model are therefore covered, while Gaussian couplings and continuous
+ * random fields are not representable and would need a non-tabulated acceptance path. The sites are reordered with reverse Cuthill-McKee at construction so that neighbours stay
+ * close in memory, and a greedy colouring groups independent sites so that every colour is swept in parallel.
+ * Sites are addressed by their index in the original graph, the reordering is internal.
+ */
+class GraphLattice final : public Lattice {
+public:
+	/**
+	 * Instantiates the lattice with all spins up.
+	 *
+	 * @param num_sites The number of sites of the graph.
+	 * @param bonds The bonds between the sites. Every bond is listed once.
+	 * @param site_fields The signs -1, 0 or +1 of the field at every site. Empty for a uniform field.
+	 */
+	GraphLattice(size_t num_sites, const std::vector<Bond> & bonds, double beta, double j, double h, const std::vector<int8_t> & site_fields = {});
+
+	/**
+	 * Creates an Edwards-Anderson spin glass on a periodic square lattice with random couplings of +1 and -1.
+	 */
+	static GraphLattice edwards_anderson(size_t lattice_length, double beta, double j, double h, uint64_t seed);
+
+	/**
+	 * Creates a bond diluted periodic square lattice where every bond is present with the given probability.
+	 */
+	static GraphLattice diluted(size_t lattice_length, double occupation, double beta, double j, double h, uint64_t seed);
+
+	void flip_spin(size_t i) override;
+	[[nodiscard]] constexpr size_t num_sites() const noexcept override;
+	[[nodiscard]] int coordination() const noexcept override;
+
+	[[nodiscard]] int64_t bond_sum() const override;
+	[[nodiscard]] int bond_sum_diff(size_t i) const override;
+
+	[[nodiscard]] int64_t spin_sum() const override;
+	[[nodiscard]] int spin_sum_diff(size_t i) const override;
+	[[nodiscard]] int field_sum_diff(size_t i) const override;
+
+	[[nodiscard]] double action() const override;
+	[[nodiscard]] double action_diff(size_t i) const override;
+
+	/**
+	 * Returns the number of colours of the greedy colouring.
+	 */
+	[[nodiscard]] size_t num_colours() const noexcept;
+
+protected:
+	/**
+	 * Sweeps the sites colour by colour. Sites of one colour have no bonds between them and are updated in parallel
+	 * once the lattice is large enough to amortize the scheduling. The parallel sweeps split every colour into chunks
+	 * of PARALLEL_CHUNK sites with their own random streams, which are derived from a number drawn from the random
+	 * buffer of the calling thread, so they are reproducible after seeding regardless of the scheduling.
+	 */
+	void sweep() override;
+
+private:
+	/**
+	 * The number of sites from which on the colours are swept in parallel.
+	 */
+	static constexpr size_t PARALLEL_SITES = 1 << 14;
+
+	/**
+	 * The number of sites per random stream of the parallel sweeps.
+	 */
+	static constexpr size_t PARALLEL_CHUNK = 1 << 12;
+
+	/**
+	 * Calculates the reverse Cuthill-McKee ordering of the graph. Returns the original index of every new index.
+	 */
+	static std::vector<uint32_t> reverse_cuthill_mckee(size_t num_sites, const std::vector<Bond> & bonds);
+
+	/**
+	 * Groups the sites into colours such that no two sites of the same colour share a bond.
+	 */
+	void colour_greedily();
+
+	/**
+	 * Calculates the field weighted spin sum difference of a flip at the internal index.
+	 */
+	[[nodiscard]] int site_field_sum_diff(uint32_t site) const;
+
+	/**
+	 * Attempts to flip the spin at the internal index and returns the differences of the bond and spin sums.
+	 */
+	std::pair<int64_t, int64_t> update(uint32_t site, RandomBuffer & random);
+
+	/**
+	 * Converts between the indices of the original graph and the reordered internal indices.
+	 */
+	std::vector<uint32_t> to_internal, to_original;
+
+	/**
+	 * The CSR neighbour list with the coupling of every entry.
+	 */
+	std::vector<uint32_t> offsets, neighbours;
+	std::vector<int8_t> couplings;
+
+	std::vector<int8_t> fields;
+	std::vector<int8_t> spins;
+	std::vector<std::vector<uint32_t>> colours;
+	int max_coupling_sum = 0;
+};
+
+#endif //LATTICE_GRAPH_H
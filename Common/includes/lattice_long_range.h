@@ -0,0 +1,124 @@
+#ifndef LATTICE_LONG_RANGE_H
+#define LATTICE_LONG_RANGE_H
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "lattice_observable.h"
+#include "sweep_driver.h"
+
+/**
+ * Ising model on a periodic square lattice in which every pair of spins couples with j / r^alpha, where r is the
+ * minimum image distance of the two sites. The local field j * sum of K(i - k) s_k of every site is a circular
+ * convolution of the coupling kernel with the spins, so the fields and thereby the energy are calculated with a 2D FFT
+ * in O(N log N) instead of O(N^2). The Metropolis update keeps the fields up to date after every accepted flip, so
+ * every proposal only looks up the field of its site, and recalculates them after every sweep so the rounding errors
+ * of the incremental updates do not accumulate. The cluster update of Luijten and Blöte grows Wolff clusters
+ * over all pairs by jumping directly to the next activated bond through a binary search of the cumulative bond
+ * probabilities. Every activated bond therefore costs O(log N) and the bonds which are not activated cost nothing, so
+ * the work per added site does not grow with the range of the interaction beyond the logarithmic search.
+ */
+class LongRangeLattice : public SweepDriver<LongRangeLattice> {
+	friend class SweepDriver<LongRangeLattice>;
+
+public:
+	/**
+	 * The update which is used in every sweep.
+	 */
+	enum class Update { Metropolis, Cluster };
+
+	/**
+	 * Instantiates a new lattice with all spins up.
+	 *
+	 * @param lattice_length The side length of the lattice. Must be a power of two for the FFT.
+	 * @param alpha The exponent of the decay of the coupling with the distance.
+	 * @param update The update which is used in every sweep. The cluster update requires ferromagnetic coupling.
+	 * @param cluster_updates The number of cluster updates per sweep of the cluster update.
+	 */
+	LongRangeLattice(size_t lattice_length, double alpha, double beta, double j, double h, Update update = Update::Cluster, size_t cluster_updates = 1);
+
+	/**
+	 * Returns the number of spins in the lattice.
+	 */
+	[[nodiscard]] size_t num_sites() const noexcept;
+
+	/**
+	 * Calculates the total energy of the lattice from the local fields.
+	 */
+	[[nodiscard]] double energy() const;
+
+	/**
+	 * Calculates the total magnetization of the lattice.
+	 */
+	[[nodiscard]] double magnetization() const;
+
+	/**
+	 * Calculates the energy difference if one was to flip the spin at index i.
+	 */
+	[[nodiscard]] double energy_diff(size_t i) const;
+
+	/**
+	 * Returns the current observables.
+	 */
+	[[nodiscard]] LatticeObservable observable() const;
+
+	/**
+	 * Flips the spin at index i and updates the local fields of all sites.
+	 */
+	void flip_spin(size_t i);
+
+	/**
+	 * Recalculates the local fields of all sites from the spins with the FFT.
+	 */
+	void update_fields();
+
+	/**
+	 * Proposes to flip every spin once and accepts with the Metropolis probability.
+	 */
+	void metropolis_sweep();
+
+	/**
+	 * Grows and flips a single Luijten-Blöte cluster from a random seed site and returns its size. The local fields are
+	 * stale afterwards until update_fields is called.
+	 */
+	size_t cluster_update();
+
+private:
+	/**
+	 * Performs one Metropolis sweep or a fixed number of cluster updates, each followed by an update of the fields. The
+	 * number of cluster updates must not depend on the cluster sizes, otherwise the measurements after every sweep are
+	 * biased towards configurations which produce large clusters.
+	 */
+	void sweep();
+
+	const size_t lattice_length;
+	double alpha, beta, j, h;
+
+	Update update;
+	size_t cluster_updates;
+	size_t current_sweeps = 0;
+	int64_t current_spins;
+
+	/**
+	 * The spins and the local fields sum of K(i - k) s_k in row-major order.
+	 */
+	std::vector<int8_t> spins;
+	std::vector<double> fields;
+
+	/**
+	 * The coupling kernel K(r) = 1 / r^alpha indexed by the row-major offset and its transform.
+	 */
+	std::vector<double> kernel;
+	std::vector<std::complex<double>> kernel_transform;
+
+	/**
+	 * The cumulative sums of 2 beta j K over the offsets 1 ... N - 1 for the cluster update, and the cluster members.
+	 */
+	std::vector<double> cumulative_bonds;
+	std::vector<uint32_t> cluster;
+	std::vector<uint8_t> in_cluster;
+};
+
+#endif //LATTICE_LONG_RANGE_H
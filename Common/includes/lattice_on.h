@@ -0,0 +1,111 @@
+#ifndef LATTICE_ON_H
+#define LATTICE_ON_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "lattice_observable.h"
+#include "random_buffer.h"
+#include "sweep_driver.h"
+
+/**
+ * O(n) model of n-component unit spins on a periodic square lattice with coupling j and a field h along the first
+ * component. The spins are stored as one float array per component with the two checkerboard sublattices stored one
+ * after the other, so every update loops over a contiguous range of independent sites. Every sweep consists of one
+ * Metropolis or heat-bath sweep followed by a number of microcanonical over-relaxation sweeps, which leave the energy
+ * unchanged but strongly reduce the autocorrelation time. Observables are reported as energy and the modulus of the
+ * magnetization.
+ */
+template<size_t N>
+class OnLattice : public SweepDriver<OnLattice<N>> {
+	friend class SweepDriver<OnLattice>;
+
+public:
+	/**
+	 * The update which thermalizes the energy in every sweep.
+	 */
+	enum class Update { Metropolis, HeatBath };
+
+	/**
+	 * Instantiates a new lattice with all spins along the first component.
+	 *
+	 * @param lattice_length The side length of the lattice. Must be even for the checkerboard decomposition.
+	 * @param update The update which thermalizes the energy.
+	 * @param over_relaxations The number of over-relaxation sweeps after every thermalizing sweep.
+	 */
+	OnLattice(size_t lattice_length, double beta, double j, double h, Update update = Update::HeatBath, size_t over_relaxations = 1);
+
+	/**
+	 * Returns the number of spins in the lattice.
+	 */
+	[[nodiscard]] size_t num_sites() const noexcept;
+
+	/**
+	 * Calculates the total energy of the lattice.
+	 */
+	[[nodiscard]] double energy() const;
+
+	/**
+	 * Calculates the modulus of the total magnetization of the lattice.
+	 */
+	[[nodiscard]] double magnetization() const;
+
+	/**
+	 * Returns the current observables.
+	 */
+	[[nodiscard]] LatticeObservable observable() const;
+
+	/**
+	 * Proposes a uniformly random new direction for every site and accepts it with the Metropolis probability.
+	 */
+	void metropolis_sweep();
+
+	/**
+	 * Draws every spin from its conditional Boltzmann distribution in the field of its neighbours. The Heisenberg
+	 * spins are sampled by inverting the distribution of the angle to the field, which vectorizes like the Metropolis
+	 * sweep. The XY spins need the rejection sampler of Best and Fisher, whose data-dependent number of iterations
+	 * keeps the sites from being processed in lockstep, so they are updated one by one.
+	 */
+	void heat_bath_sweep();
+
+	/**
+	 * Reflects every spin at the field of its neighbours, which keeps the energy constant.
+	 */
+	void over_relaxation_sweep();
+
+private:
+	/**
+	 * The number of sites for which the random numbers are drawn at once by the vectorized sweeps.
+	 */
+	static constexpr size_t CHUNK_SIZE = 256;
+
+	/**
+	 * Performs one thermalizing sweep followed by the over-relaxation sweeps.
+	 */
+	void sweep();
+
+	/**
+	 * Calculates the local field j * sum of the neighbours + h along the first component at site i.
+	 */
+	[[nodiscard]] std::array<float, N> local_field(size_t i) const;
+
+	const size_t lattice_length;
+	double beta, j, h;
+
+	Update update;
+	size_t over_relaxations;
+	size_t current_sweeps = 0;
+
+	/**
+	 * The spin components and the four neighbours of every site in checkerboard order.
+	 */
+	std::array<std::vector<float>, N> components;
+	std::vector<uint32_t> neighbours;
+};
+
+using XYLattice = OnLattice<2>;
+using HeisenbergLattice = OnLattice<3>;
+
+#endif //LATTICE_ON_H
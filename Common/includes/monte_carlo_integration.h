@@ -0,0 +1,75 @@
+#ifndef MONTE_CARLO_INTEGRATION_H
+#define MONTE_CARLO_INTEGRATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+
+class RandomBuffer;
+
+/**
+ * The sequence from which the sample points in the unit square are drawn. The quasi-random Halton and Sobol sequences
+ * fill the square evenly, so the error decreases as 1 / N instead of 1 / sqrt(N) for smooth integrands.
+ */
+enum class SampleSequence { Pseudo, Halton, Sobol };
+
+/**
+ * The estimate of a Monte Carlo integral. The uncertainty is the standard error of the batch means, which is only
+ * meaningful for pseudo-random samples.
+ */
+struct IntegrationEstimate {
+	size_t samples;
+	double mean, uncertainty;
+};
+
+/**
+ * Integrates functions over the unit square. The samples are generated in batches of BATCH_SIZE points, which are
+ * handed to the integrand as two arrays of coordinates, so the integrand is evaluated by a vectorized loop instead of
+ * one function call per point. The batches are reduced in parallel with per-thread partial sums.
+ */
+class MonteCarloIntegrator {
+public:
+	/**
+	 * The number of points per batch handed to the integrand.
+	 */
+	static constexpr size_t BATCH_SIZE = 1024;
+
+	/**
+	 * Returns the sum of the integrand over the points of a batch.
+	 */
+	using Integrand = std::function<double(std::span<const double> x, std::span<const double> y)>;
+
+	/**
+	 * @param sequence The sequence from which the sample points are drawn.
+	 * @param seed The seed of the pseudo-random numbers, which are reproducible independent of the number of threads.
+	 */
+	explicit MonteCarloIntegrator(SampleSequence sequence, uint64_t seed = 0);
+
+	/**
+	 * Estimates the mean of the integrand over the unit square from the given number of samples, which is rounded up
+	 * to a whole number of batches.
+	 *
+	 * @param integrand Sums the integrand over a batch. Called concurrently.
+	 * @param num_samples The number of sample points.
+	 * @return The estimated integral.
+	 */
+	[[nodiscard]] IntegrationEstimate integrate(const Integrand & integrand, size_t num_samples) const;
+
+	/**
+	 * Counts the points inside the quarter of the unit circle, whose mean is pi / 4.
+	 */
+	static double quarter_circle(std::span<const double> x, std::span<const double> y);
+
+private:
+	/**
+	 * Fills the coordinates of the sample points with the given indices into the sequence. Pseudo-random points are
+	 * drawn from the given buffer of the task instead, the quasi-random sequences ignore it.
+	 */
+	void generate(uint64_t first, std::span<double> x, std::span<double> y, RandomBuffer & random) const;
+
+	SampleSequence sequence;
+	uint64_t seed;
+};
+
+#endif //MONTE_CARLO_INTEGRATION_H
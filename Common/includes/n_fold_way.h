@@ -0,0 +1,116 @@
+#ifndef N_FOLD_WAY_H
+#define N_FOLD_WAY_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "lattice.h"
+#include "lattice_2d.h"
+#include "lattice_observable.h"
+#include "sweep_driver.h"
+
+/**
+ * Rejection-free n-fold way kinetic Monte Carlo of Bortz, Kalos and Lebowitz on a 2D lattice. Every site belongs to
+ * one of ten classes given by its spin and the sum of its four neighbours, all sites of a class share the Metropolis
+ * acceptance of the lattice as flip rate. Every step picks a class with probability proportional to its total rate and
+ * a uniformly random site of the class, flips it and advances the physical time by an exponential waiting time with
+ * the inverse total rate as mean. Only the flipped site and its neighbours change their class, so the class populations
+ * are kept up to date in O(1) per flip.
+ *
+ * The dynamics is continuous-time random-site Metropolis with one sweep as unit of time, so the time statistics match
+ * random-site Metropolis sweeps while no time is spent on rejected proposals. This pays off at large j where almost
+ * every proposal is rejected. They do not match the checkerboard sweeps of Lattice2D, whose autocorrelation times
+ * differ, so only equilibrium averages are comparable between the two.
+ *
+ * The flip rates are read from the acceptance table of the lattice at the start of every advance, so annealing the
+ * lattice between two advances changes the rates accordingly.
+ */
+class NFoldWay : public SweepDriver<NFoldWay> {
+	friend class SweepDriver<NFoldWay>;
+
+public:
+	/**
+	 * Sorts the sites of the lattice into their classes. The lattice must not be changed by other means while the
+	 * engine is in use.
+	 */
+	explicit NFoldWay(Lattice2D & lattice);
+
+	/**
+	 * Returns the physical time in sweeps.
+	 */
+	[[nodiscard]] double time() const noexcept;
+
+	/**
+	 * Returns the number of flips made so far.
+	 */
+	[[nodiscard]] size_t flips() const noexcept;
+
+	/**
+	 * Returns the sum of the flip rates of all sites, which is the expected number of flips per sweep.
+	 */
+	[[nodiscard]] double total_rate() const noexcept;
+
+	/**
+	 * Returns the current observables of the lattice with the elapsed whole sweeps of physical time.
+	 */
+	[[nodiscard]] LatticeObservable observable() const;
+
+	/**
+	 * Advances the physical time by the given number of sweeps, flipping spins at the drawn event times. Because the
+	 * waiting times are exponential, the time left over after the last flip is simply discarded.
+	 */
+	void advance(double duration);
+
+private:
+	static constexpr size_t NUM_CLASSES = 10;
+
+	/**
+	 * Advances the physical time by one sweep, the unit in which the sweep driver runs and measures.
+	 */
+	void sweep();
+
+	/**
+	 * Returns the number of sites of the lattice.
+	 */
+	[[nodiscard]] size_t num_sites() const noexcept;
+
+	/**
+	 * Returns the class of the site at index i from its spin and bond sum difference.
+	 */
+	[[nodiscard]] uint8_t classify(size_t i) const;
+
+	/**
+	 * Returns the flip rate of every class from the current acceptance table of the lattice.
+	 */
+	[[nodiscard]] std::array<double, NUM_CLASSES> class_rates() const;
+
+	/**
+	 * Returns the sum of the given flip rates over all sites.
+	 */
+	[[nodiscard]] double total_rate(const std::array<double, NUM_CLASSES> & rates) const noexcept;
+
+	/**
+	 * Moves the site at index i into the given class.
+	 */
+	void move(size_t i, uint8_t target);
+
+	/**
+	 * Flips the site at index i and moves it and its neighbours into their new classes.
+	 */
+	void flip(size_t i);
+
+	Lattice2D & lattice;
+	double current_time = 0.0;
+	size_t num_flips = 0;
+
+	/**
+	 * The member sites of every class and the class and position within the class of every site.
+	 */
+	std::array<std::vector<uint32_t>, NUM_CLASSES> members;
+	std::vector<uint8_t> classes;
+	std::vector<uint32_t> positions;
+};
+
+#endif //N_FOLD_WAY_H
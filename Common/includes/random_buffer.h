@@ -0,0 +1,84 @@
+#ifndef RANDOM_BUFFER_H
+#define RANDOM_BUFFER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+/**
+ * Buffered front-end of LANES interleaved xoshiro256** generators. The states of the generators are stored one array
+ * per state word, so the refill of a block of raw 64-bit numbers advances all generators at once in a loop which the
+ * compiler vectorizes. Samplers draw from the block with a single load and compare the raw integer against a
+ * precomputed threshold instead of converting it to a floating point number first.
+ */
+class RandomBuffer {
+public:
+	/**
+	 * The number of interleaved generators and the number of raw numbers per block.
+	 */
+	static constexpr size_t LANES = 8;
+	static constexpr size_t BLOCK_SIZE = 512;
+
+	/**
+	 * Seeds the generators from the seed and the stream, so different streams of the same seed are independent.
+	 */
+	explicit RandomBuffer(uint64_t seed, uint64_t stream = 0);
+
+	/**
+	 * Returns the buffer of the calling thread, which is seeded from std::random_device until reseeded.
+	 */
+	static RandomBuffer & local();
+
+	/**
+	 * Converts a probability into the threshold for which next() < threshold holds with that probability. Every
+	 * probability of at least one maps onto the largest threshold, which misses certainty by 2^-64.
+	 */
+	static uint64_t threshold(double probability) noexcept;
+
+	/**
+	 * Reseeds the generators and discards the buffered numbers.
+	 */
+	void seed(uint64_t seed, uint64_t stream = 0);
+
+	/**
+	 * Returns the next raw 64-bit number.
+	 */
+	uint64_t next() noexcept {
+		if (position == BLOCK_SIZE) refill();
+		return buffer[position++];
+	}
+
+	/**
+	 * Returns true with the probability the threshold was calculated from.
+	 */
+	bool accept(const uint64_t threshold) noexcept {
+		return next() < threshold;
+	}
+
+	/**
+	 * Returns a uniform random number [0, 1) with 53 random bits.
+	 */
+	double uniform() noexcept {
+		return static_cast<double>(next() >> 11) * 0x1.0p-53;
+	}
+
+	/**
+	 * Returns a uniform random number [0, 1) with 24 random bits, the precision of a float.
+	 */
+	float uniform_float() noexcept {
+		return static_cast<float>(next() >> 40) * 0x1.0p-24f;
+	}
+
+private:
+	/**
+	 * Advances all generators BLOCK_SIZE / LANES times and stores their outputs in the buffer.
+	 */
+	void refill() noexcept;
+
+	std::array<std::array<uint64_t, LANES>, 4> state;
+	std::array<uint64_t, BLOCK_SIZE> buffer;
+	size_t position = BLOCK_SIZE;
+};
+
+#endif //RANDOM_BUFFER_H
@@ -0,0 +1,114 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lattice_observable.h"
+#include "run_spec.h"
+
+/**
+ * Content-addressed on-disk cache of scan results. Every result is a list of doubles stored under the hash of the
+ * run specification and the version, so only points which are new or changed have to be computed again. The version
+ * combines the version of the driver with a hash of the Common sources taken at configure time, so changes of the
+ * shared algorithms invalidate the results as well. The serialized specification is stored next to every result and
+ * compared on lookup, so a hash collision cannot return the result of a different run. The cache is an append-only
+ * binary file in the output/cache directory and may be shared between threads. Only an index of the specifications and
+ * the file offsets of their results is kept in memory, the results are read from the file when they are fetched, so
+ * the memory does not grow with the size of the cache.
+ */
+class ResultCache {
+public:
+	/**
+	 * Receives blocks of the values of a streamed result.
+	 */
+	using ValueSink = std::function<void(std::span<const double>)>;
+
+	/**
+	 * Opens the cache with the given name and indexes all results of the current version. Results of other versions
+	 * and superseded or truncated entries are dropped by rewriting the file once.
+	 *
+	 * @param name The name of the cache file.
+	 * @param version The version of the driver's algorithms, which must be bumped whenever they change.
+	 */
+	ResultCache(const std::string & name, const std::string & version);
+
+	/**
+	 * Returns the cached result for the given specification or computes and stores it if it is not cached yet.
+	 *
+	 * @param spec The specification of the run.
+	 * @param compute Computes the result if it is not cached yet.
+	 * @return The result of the run.
+	 */
+	std::vector<double> fetch(const RunSpec & spec, const std::function<std::vector<double>()> & compute);
+
+	/**
+	 * Streams the cached result for the given specification to the sink in blocks or computes it if it is not cached
+	 * yet. The computation hands its values to the given append function in blocks, which spills them to a temporary
+	 * file that is appended to the cache once the computation returns, so neither path holds the whole result in
+	 * memory. The sink is only called for cached results, a computation consumes its own values.
+	 *
+	 * @param spec The specification of the run.
+	 * @param compute Computes the result if it is not cached yet and appends its values in blocks.
+	 * @param sink Receives the blocks of a cached result.
+	 * @param block_values The number of values per block handed to the sink. Records of several values are never
+	 * split between two blocks if it is a multiple of their size.
+	 */
+	void stream(const RunSpec & spec, const std::function<void(const ValueSink &)> & compute, const ValueSink & sink, size_t block_values);
+
+private:
+	/**
+	 * The serialized specification of a cached result and the position of its values in the file.
+	 */
+	struct Location {
+		std::string spec;
+		uint64_t offset, count;
+	};
+
+	/**
+	 * Appends the header of an entry to the file and returns the number of bytes written.
+	 */
+	static uint64_t write_header(std::ostream & output, uint64_t hash, const std::string & spec, uint64_t count);
+
+	/**
+	 * Reads the values of the entry at the given location from the file.
+	 */
+	[[nodiscard]] std::vector<double> read(const Location & location) const;
+
+	/**
+	 * Reads the values of the entry at the given location from the file and hands them to the sink in blocks.
+	 */
+	void read(const Location & location, const ValueSink & sink, size_t block_values) const;
+
+	const std::string version, path;
+
+	std::mutex index_mtx;
+	std::unordered_map<uint64_t, Location> index;
+	std::ofstream file;
+	uint64_t end = 0;
+
+	/**
+	 * Numbers the spill files of the streamed computations.
+	 */
+	std::atomic<uint64_t> spills = 0;
+};
+
+/**
+ * Flattens a history of observables into the sweeps, energy and magnetization of every entry.
+ */
+std::vector<double> serialize_history(std::span<const LatticeObservable> history);
+
+/**
+ * Restores a history of observables flattened by serialize_history.
+ */
+std::vector<LatticeObservable> deserialize_history(std::span<const double> values, double j);
+
+#endif //RESULT_CACHE_H
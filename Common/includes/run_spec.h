@@ -0,0 +1,58 @@
+#ifndef RUN_SPEC_H
+#define RUN_SPEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * Declarative specification of a single point of a parameter scan. Two runs with equal specifications produce the
+ * same results, which makes the specification usable as the key of the result cache.
+ */
+struct RunSpec {
+	/**
+	 * Hashes all fields of the specification together with the version of the binary using 64-bit FNV-1a.
+	 *
+	 * @param version The version of the binary which computes the results.
+	 * @return The hash of the specification.
+	 */
+	[[nodiscard]] uint64_t hash(std::string_view version) const;
+
+	/**
+	 * Writes all fields of the specification together with the version as text, which is stored next to every cached
+	 * result so that a hash collision cannot return the result of a different run.
+	 *
+	 * @param version The version of the binary which computes the results.
+	 * @return The serialized specification, starting with "version=<version>;".
+	 */
+	[[nodiscard]] std::string serialize(std::string_view version) const;
+
+	/**
+	 * The lattice type, e.g. "1d" or "2d", and its side length.
+	 */
+	std::string lattice;
+	size_t lattice_length = 0;
+
+	/**
+	 * The inverse temperature, coupling constant j and the magnetic field strength h.
+	 */
+	double beta = 0.0, j = 0.0, h = 0.0;
+
+	/**
+	 * The number of sweeps per experiment and the number of independent experiments.
+	 */
+	size_t sweeps = 0, experiments = 1;
+
+	/**
+	 * The seed of the random number generator of the first experiment.
+	 */
+	uint64_t seed = 0;
+
+	/**
+	 * The algorithm used to compute the results, e.g. "exact" or "metropolis".
+	 */
+	std::string algorithm;
+};
+
+#endif //RUN_SPEC_H
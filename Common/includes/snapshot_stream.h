@@ -0,0 +1,168 @@
+#ifndef SNAPSHOT_STREAM_H
+#define SNAPSHOT_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+#include <vector>
+
+/**
+ * The encoding options of a snapshot stream.
+ */
+struct SnapshotOptions {
+	/**
+	 * Every keyframe_interval-th frame is stored without delta encoding, which bounds the number of frames decoded
+	 * to reach an arbitrary frame.
+	 */
+	size_t keyframe_interval = 64;
+
+	/**
+	 * Whether frames between keyframes store the XOR with the previous frame instead of the frame itself.
+	 */
+	bool delta = true;
+
+	/**
+	 * Whether the frames are run-length encoded, either as runs of repeated 64-bit words or as the lengths of the runs
+	 * of zero bits between set bits, whichever is smaller. The latter compresses sparse delta frames.
+	 */
+	bool run_length = true;
+};
+
+/**
+ * How the words of a frame are stored.
+ */
+enum class SnapshotEncoding : uint32_t { Raw, WordRuns, BitRuns };
+
+/**
+ * Precedes every frame in a snapshot file, which makes the frames self-delimiting.
+ */
+struct SnapshotFrameHeader {
+	uint64_t sweeps, bytes;
+	uint32_t keyframe;
+	SnapshotEncoding encoding;
+};
+
+/**
+ * The position of the payload of a frame in a snapshot file.
+ */
+struct SnapshotIndexEntry {
+	uint64_t sweeps, offset, bytes;
+	uint32_t keyframe;
+	SnapshotEncoding encoding;
+};
+
+/**
+ * Appends spin configurations to output/<file_name>.snap as frames with one bit per spin. Between keyframes the
+ * frames are XOR encoded against the previous frame, so only the flipped spins are set, and run-length encoded.
+ * Close to equilibrium only a small fraction of the spins flips between two frames. Every frame starts with a header
+ * holding its size, and the file is flushed at every keyframe, so the frames written before a crash can be recovered by
+ * scanning. The index of all frames is appended when the stream is closed, so every frame can be located without
+ * scanning the file.
+ */
+class SnapshotWriter {
+public:
+	/**
+	 * Opens the snapshot file and writes the header.
+	 *
+	 * @param file_name The name of the snapshot file in the output directory.
+	 * @param num_sites The number of spins per configuration.
+	 * @param options The encoding options.
+	 */
+	SnapshotWriter(const std::string & file_name, size_t num_sites, SnapshotOptions options = {});
+
+	SnapshotWriter(const SnapshotWriter &) = delete;
+	SnapshotWriter & operator=(const SnapshotWriter &) = delete;
+
+	~SnapshotWriter();
+
+	/**
+	 * Encodes and appends a configuration.
+	 *
+	 * @param sweeps The number of sweeps after which the configuration was recorded.
+	 * @param spins The spins, which must be +1 or -1.
+	 */
+	void write(size_t sweeps, std::span<const int8_t> spins);
+
+	/**
+	 * Appends the index and closes the file.
+	 */
+	void close();
+
+	/**
+	 * Returns the number of bytes of the encoded frames.
+	 */
+	[[nodiscard]] size_t frame_bytes() const noexcept;
+
+	/**
+	 * Returns the number of frames written.
+	 */
+	[[nodiscard]] size_t size() const noexcept;
+
+private:
+	const size_t num_sites;
+	const SnapshotOptions options;
+
+	std::ofstream output;
+	std::vector<uint64_t> previous, current, delta;
+	std::vector<uint8_t> encoded, candidate;
+	std::vector<SnapshotIndexEntry> index;
+	uint64_t offset = 0, total_frame_bytes = 0;
+};
+
+/**
+ * Reads frames from a snapshot file which is memory-mapped, so only the pages of the decoded frames are loaded.
+ */
+class SnapshotReader {
+public:
+	/**
+	 * Maps output/<file_name>.snap and reads its index. If the file was not closed, the index is rebuilt from the frame
+	 * headers up to the last complete frame.
+	 */
+	explicit SnapshotReader(const std::string & file_name);
+
+	SnapshotReader(const SnapshotReader &) = delete;
+	SnapshotReader & operator=(const SnapshotReader &) = delete;
+
+	~SnapshotReader();
+
+	/**
+	 * Returns the number of frames.
+	 */
+	[[nodiscard]] size_t size() const noexcept;
+
+	/**
+	 * Returns the number of spins per configuration.
+	 */
+	[[nodiscard]] size_t num_sites() const noexcept;
+
+	/**
+	 * Returns the number of sweeps after which the frame was recorded.
+	 */
+	[[nodiscard]] size_t sweeps(size_t frame) const;
+
+	/**
+	 * Decodes the configuration of the given frame, starting from the closest preceding keyframe. Throws if the frames
+	 * are corrupt.
+	 */
+	[[nodiscard]] std::vector<int8_t> frame(size_t frame) const;
+
+private:
+	/**
+	 * Rebuilds the index from the frame headers between the file header and the end of the frames.
+	 */
+	void rebuild_index(size_t end);
+
+	/**
+	 * Decodes the words of a single frame into the given buffer, XORed into it for delta frames. Throws if the payload
+	 * does not decode into exactly the words of a frame.
+	 */
+	void decode(const SnapshotIndexEntry & entry, std::span<uint64_t> words) const;
+
+	const std::byte * data = nullptr;
+	size_t length = 0, sites = 0;
+	std::vector<SnapshotIndexEntry> index;
+};
+
+#endif //SNAPSHOT_STREAM_H
@@ -0,0 +1,115 @@
+#ifndef SWEEP_DRIVER_H
+#define SWEEP_DRIVER_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <generator>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "lattice_observable.h"
+#include "random_buffer.h"
+#include "trace.h"
+
+/**
+ * Drives the sweeps of a lattice type L, which provides sweep(), observable() and num_sites(), so all lattice types
+ * are seeded, iterated and measured in the same way. All of them draw their random numbers from the RandomBuffer of
+ * the calling thread. L must befriend the driver if its sweep is not public.
+ */
+template<typename L>
+class SweepDriver {
+public:
+	/**
+	 * Receives blocks of observables from the batched sweep driver.
+	 */
+	using ObservableSink = std::function<void(std::span<const LatticeObservable>)>;
+
+	/**
+	 * Seeds the random number generator of the calling thread so that the following sweeps are reproducible.
+	 */
+	static void seed(const uint64_t seed) {
+		RandomBuffer::local().seed(seed);
+	}
+
+	/**
+	 * Yields the observables after every sweep. Convenience wrapper around sweep which suspends the coroutine and
+	 * copies the observable after every sweep, prefer run for long simulations of small lattices.
+	 */
+	std::generator<LatticeObservable> sweeps() {
+		while (true) {
+			lattice().sweep();
+			co_yield lattice().observable();
+		}
+	}
+
+	/**
+	 * Performs the given number of sweeps in a tight loop and hands the observables of every measure_every-th sweep
+	 * to the sink in blocks of up to BLOCK_SIZE observables.
+	 *
+	 * @param num_sweeps The number of sweeps made in total.
+	 * @param sink Receives the blocks of measured observables.
+	 * @param measure_every The number of sweeps between two measurements.
+	 */
+	void run(const size_t num_sweeps, const ObservableSink & sink, const size_t measure_every = 1) {
+		assert(measure_every > 0);
+		const TraceSpan span { "run", { { "sweeps", num_sweeps }, { "sites", lattice().num_sites() } } };
+
+		std::vector<LatticeObservable> block;
+		block.reserve(std::min(BLOCK_SIZE, num_sweeps / measure_every + 1));
+
+		auto block_span = std::make_optional<TraceSpan>("sweep_block");
+		for (size_t i = 1; i <= num_sweeps; ++i) {
+			lattice().sweep();
+			if (i % measure_every != 0) continue;
+
+			block.push_back(lattice().observable());
+			if (block.size() == BLOCK_SIZE) {
+				block_span.reset();
+				{
+					const TraceSpan sink_span { "sink" };
+					sink(block);
+				}
+				block.clear();
+				block_span.emplace("sweep_block");
+			}
+		}
+		block_span.reset();
+
+		if (!block.empty()) {
+			const TraceSpan sink_span { "sink" };
+			sink(block);
+		}
+	}
+
+	/**
+	 * Performs the given number of sweeps and returns the mean observable values per spin measured after every sweep.
+	 *
+	 * @param num_sweeps The number of sweeps made in total.
+	 * @return The mean observable values.
+	 */
+	LatticeObservable metropolis_hastings(const size_t num_sweeps) {
+		const LatticeObservable start = lattice().observable();
+		LatticeObservable sum { start.sweeps, start.j, 0.0, 0.0 };
+		run(num_sweeps, [&] (const std::span<const LatticeObservable> block) {
+			sum = std::ranges::fold_left(block, sum, std::plus());
+		});
+		return sum / (lattice().num_sites() * num_sweeps);
+	}
+
+protected:
+	/**
+	 * The maximum number of observables handed to the sink of run at once.
+	 */
+	static constexpr size_t BLOCK_SIZE = 1024;
+
+private:
+	L & lattice() {
+		return static_cast<L &>(*this);
+	}
+};
+
+#endif //SWEEP_DRIVER_H
@@ -0,0 +1,148 @@
+#ifndef TIME_SERIES_H
+#define TIME_SERIES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "lattice_observable.h"
+
+/**
+ * The minimum, maximum and mean of all values which fall into one bucket of a downsampled series.
+ */
+struct SeriesBucket {
+	int64_t min, max;
+	double mean;
+};
+
+/**
+ * Append-only series of integers compressed in blocks of 128 values. Every block stores its first value followed by
+ * the zigzag encoded deltas bit-packed with the smallest width which fits all of them. Slowly changing series like
+ * the bond and spin sums of a Monte Carlo history need only a few bits per value.
+ */
+class CompressedSeries {
+public:
+	/**
+	 * Appends a value. Values are buffered until a block is complete.
+	 */
+	void push_back(int64_t value);
+
+	/**
+	 * Returns the number of values in the series.
+	 */
+	[[nodiscard]] size_t size() const noexcept;
+
+	/**
+	 * Returns the number of bytes used by the compressed blocks and the pending values.
+	 */
+	[[nodiscard]] size_t compressed_bytes() const noexcept;
+
+	/**
+	 * Decompresses the whole series.
+	 */
+	[[nodiscard]] std::vector<int64_t> decode() const;
+
+	/**
+	 * Divides the series into the given number of buckets of equal length and calculates the minimum, maximum and
+	 * mean of every bucket. The blocks are decoded one at a time so the full series is never materialized.
+	 */
+	[[nodiscard]] std::vector<SeriesBucket> downsample(size_t buckets) const;
+
+	/**
+	 * Serializes the series into a binary stream.
+	 */
+	void write(std::ostream & os) const;
+
+	/**
+	 * Deserializes a series written by write.
+	 */
+	static CompressedSeries read(std::istream & is);
+
+private:
+	static constexpr size_t BLOCK_SIZE = 128;
+
+	/**
+	 * Compresses the pending values into a new block.
+	 */
+	void encode_block();
+
+	/**
+	 * Decompresses the block starting at the given offset into values and returns the offset of the next block.
+	 */
+	size_t decode_block(size_t offset, std::vector<int64_t> & values) const;
+
+	size_t count = 0;
+	std::vector<uint8_t> blocks;
+	std::vector<int64_t> pending;
+};
+
+/**
+ * One bucket of a downsampled Monte Carlo history in physical units per site.
+ */
+struct HistoryBucket {
+	friend std::ostream & operator<<(std::ostream & os, const HistoryBucket & bucket) {
+		std::stringstream output;
+		output << bucket.sweeps << "," << bucket.energy_min << "," << bucket.energy_max << "," << bucket.energy_mean << ","
+			<< bucket.magnetization_min << "," << bucket.magnetization_max << "," << bucket.magnetization_mean;
+		return os << output.str();
+	}
+
+	size_t sweeps;
+	double energy_min, energy_max, energy_mean;
+	double magnetization_min, magnetization_max, magnetization_mean;
+};
+
+/**
+ * Compressed history of the observables of a single Monte Carlo run with constant coupling j. Energies are stored as
+ * integer bond sums and magnetizations as integer spin sums, while the sweep count is implicit.
+ */
+class ObservableHistory {
+public:
+	ObservableHistory(double j, size_t num_sites);
+
+	/**
+	 * Appends the observable per site of the next sweep.
+	 */
+	void push(const LatticeObservable & observable);
+
+	/**
+	 * Returns the number of sweeps in the history.
+	 */
+	[[nodiscard]] size_t size() const noexcept;
+
+	/**
+	 * Returns the number of bytes used by the compressed history.
+	 */
+	[[nodiscard]] size_t compressed_bytes() const noexcept;
+
+	/**
+	 * Decompresses the full history into observables per site.
+	 */
+	[[nodiscard]] std::vector<LatticeObservable> decode() const;
+
+	/**
+	 * Downsamples the history into the given number of buckets in physical units per site.
+	 */
+	[[nodiscard]] std::vector<HistoryBucket> downsample(size_t buckets) const;
+
+	/**
+	 * Writes the compressed history to a binary file in the output directory.
+	 */
+	void write(const std::string & file_name) const;
+
+	/**
+	 * Reads a compressed history from a binary file in the output directory.
+	 */
+	static ObservableHistory read(const std::string & file_name);
+
+private:
+	double j;
+	size_t num_sites, first_sweep = 0;
+	CompressedSeries bonds, spins;
+};
+
+#endif //TIME_SERIES_H
@@ -0,0 +1,89 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * Records the time between its construction and destruction as a complete event on the timeline of the calling
+ * thread. Every thread appends to its own buffer of at most MAX_EVENTS events, so recording never waits on other
+ * threads and long runs cannot exhaust the memory. Once tracing is enabled the events of all threads are written as
+ * Chrome trace-event JSON at exit, which can be opened in Perfetto or chrome://tracing. While tracing is disabled a
+ * span only costs a single relaxed atomic load, the name and arguments are neither copied nor formatted.
+ */
+class TraceSpan {
+public:
+	/**
+	 * A named numeric argument attached to the span, such as the lattice size or coupling constant.
+	 */
+	struct Argument {
+		Argument() = default;
+
+		template<typename T, std::enable_if_t<std::is_arithmetic_v<T>>* = nullptr>
+		Argument(const std::string_view key, const T value) : key(key), value(static_cast<double>(value)) {}
+
+		std::string_view key;
+		double value;
+	};
+
+	using Arguments = std::initializer_list<Argument>;
+
+	/**
+	 * The maximum number of arguments per span, further arguments are dropped.
+	 */
+	static constexpr size_t MAX_ARGUMENTS = 4;
+
+	/**
+	 * The maximum number of events recorded per thread, later events are counted but dropped.
+	 */
+	static constexpr size_t MAX_EVENTS = 1 << 16;
+
+	/**
+	 * Begins a span with the given name and arguments. The name and the keys are stored as views, so they must be
+	 * string literals or otherwise outlive the program. The first span of a thread allocates its event buffer.
+	 */
+	explicit TraceSpan(const std::string_view name, const Arguments arguments = {})
+		: active(recording.load(std::memory_order_relaxed)) {
+		if (active) [[unlikely]] begin_span(name, arguments);
+	}
+
+	/**
+	 * Ends the span and records it.
+	 */
+	~TraceSpan() {
+		if (active) [[unlikely]] end_span();
+	}
+
+	TraceSpan(const TraceSpan &) = delete;
+	TraceSpan & operator=(const TraceSpan &) = delete;
+
+	/**
+	 * Starts recording spans and writes them to output/<file_name>.json when the program exits.
+	 */
+	static void enable(const std::string & file_name);
+
+	/**
+	 * Writes the spans recorded so far to output/<file_name>.json. Must not be called while spans are recorded.
+	 */
+	static void write(const std::string & file_name);
+
+private:
+	void begin_span(std::string_view name, Arguments arguments);
+	void end_span() noexcept;
+
+	static inline std::atomic_bool recording { false };
+
+	bool active;
+	uint8_t num_arguments;
+	std::string_view name;
+	std::array<Argument, MAX_ARGUMENTS> arguments;
+	int64_t begin;
+};
+
+#endif //TRACE_H
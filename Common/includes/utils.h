@@ -6,11 +6,13 @@
 #include <functional>
 #include <iterator>
 #include <experiment.h>
+#include <trace.h>
 
 Experiment<int64_t> measure_execution(const std::function<void()> & lambda, size_t num_runs);
 
 template<typename T>
 void write_output_csv(const std::span<const T> measurements, const std::string & file_name, const std::string & headers) {
+	const TraceSpan span { "write_csv", { { "rows", measurements.size() } } };
 	std::ofstream output;
 	output.open("output/" + file_name + ".csv");
 
@@ -0,0 +1,79 @@
+#include "adaptive_result.h"
+
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <limits>
+
+#include "fft.h"
+
+/**
+ * The series must be longer than this many autocorrelation times for the estimate to be trusted.
+ */
+constexpr double MIN_AUTOCORRELATION_TIMES = 50.0;
+
+ObservableEstimate::ObservableEstimate(const std::span<const double> series) {
+	const size_t n = series.size();
+	assert(n > 1);
+
+	for (const double value : series) mean += value;
+	mean /= static_cast<double>(n);
+
+	// Zero padding to twice the length turns the circular into the linear autocorrelation.
+	std::vector<std::complex<double>> transform (std::bit_ceil(2 * n));
+	for (size_t i = 0; i < n; ++i) transform[i] = series[i] - mean;
+	fft(transform);
+	for (std::complex<double> & value : transform) value = std::norm(value);
+	fft(transform, true);
+
+	const double variance = transform[0].real() / static_cast<double>(n);
+	if (variance <= 0.0) {
+		effective_samples = static_cast<double>(n);
+		return;
+	}
+
+	const auto autocorrelation = [&] (const size_t t) {
+		return t < n ? transform[t].real() / (static_cast<double>(n - t) * variance) : 0.0;
+	};
+
+	// The sums of consecutive pairs of the autocorrelation function are positive and decreasing for reversible
+	// chains, so summing them until the first one which is not also works for oscillating autocorrelations.
+	double sum = 0.0, previous = std::numeric_limits<double>::infinity();
+	for (size_t t = 0; t + 1 < n; t += 2) {
+		const double pair = std::min(previous, autocorrelation(t) + autocorrelation(t + 1));
+		if (pair <= 0.0) break;
+		sum += pair;
+		previous = pair;
+	}
+	autocorrelation_time = std::max(sum - 0.5, 0.5);
+
+	effective_samples = static_cast<double>(n) / (2.0 * autocorrelation_time);
+	error = std::sqrt(variance / effective_samples);
+}
+
+bool ObservableEstimate::reliable(const size_t num_samples) const {
+	return static_cast<double>(num_samples) >= MIN_AUTOCORRELATION_TIMES * autocorrelation_time;
+}
+
+AdaptiveResult::AdaptiveResult(const double parameter, const size_t sweeps, const ObservableEstimate energy, const ObservableEstimate magnetization, const StopReason reason)
+	: parameter(parameter), sweeps(sweeps), energy(energy), magnetization(magnetization), reason(reason)
+{ }
+
+AdaptiveResult::AdaptiveResult(const std::span<const double> values) {
+	assert(values.size() == 11);
+	parameter = values[0];
+	sweeps = static_cast<size_t>(values[1]);
+	energy.mean = values[2], energy.error = values[3], energy.autocorrelation_time = values[4], energy.effective_samples = values[5];
+	magnetization.mean = values[6], magnetization.error = values[7], magnetization.autocorrelation_time = values[8], magnetization.effective_samples = values[9];
+	reason = values[10] != 0.0 ? StopReason::TargetReached : StopReason::BudgetExhausted;
+}
+
+std::vector<double> AdaptiveResult::serialize() const {
+	return {
+		parameter, static_cast<double>(sweeps),
+		energy.mean, energy.error, energy.autocorrelation_time, energy.effective_samples,
+		magnetization.mean, magnetization.error, magnetization.autocorrelation_time, magnetization.effective_samples,
+		reason == StopReason::TargetReached ? 1.0 : 0.0
+	};
+}
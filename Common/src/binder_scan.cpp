@@ -0,0 +1,191 @@
+#include "binder_scan.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <execution>
+#include <limits>
+#include <mutex>
+#include <ranges>
+#include <tuple>
+
+/**
+ * The Binder cumulant and susceptibility per spin given the moments of the magnetization.
+ */
+static std::pair<double, double> binder_susceptibility(const double num_sites, const double beta, const double m1, const double m2, const double m4) {
+	return { 1.0 - m4 / (3.0 * m2 * m2), beta * num_sites * (m2 - m1 * m1) };
+}
+
+BinderPoint::BinderPoint(const size_t lattice_length, const double beta, const double j, const std::span<const double> magnetizations, size_t num_blocks)
+	: lattice_length(lattice_length), j(j), samples(magnetizations.size()) {
+	num_blocks = std::min(num_blocks, magnetizations.size());
+	assert(num_blocks > 1);
+
+	const size_t block_size = magnetizations.size() / num_blocks;
+	const double num_sites = static_cast<double>(lattice_length * lattice_length);
+
+	std::vector<std::array<double, 3>> blocks (num_blocks, { 0.0, 0.0, 0.0 });
+	for (const size_t i : std::views::iota(static_cast<size_t>(0), num_blocks * block_size)) {
+		const double m = std::abs(magnetizations[i]), m2 = m * m;
+		blocks[i / block_size][0] += m;
+		blocks[i / block_size][1] += m2;
+		blocks[i / block_size][2] += m2 * m2;
+	}
+
+	std::array<double, 3> total { 0.0, 0.0, 0.0 };
+	for (const std::array<double, 3> & block : blocks) {
+		for (const size_t k : { 0, 1, 2 }) total[k] += block[k];
+	}
+
+	const double n = static_cast<double>(num_blocks * block_size);
+	std::tie(binder, susceptibility) = binder_susceptibility(num_sites, beta, total[0] / n, total[1] / n, total[2] / n);
+
+	double binder_variance = 0.0, susceptibility_variance = 0.0;
+	for (const std::array<double, 3> & block : blocks) {
+		const double m = n - static_cast<double>(block_size);
+		const auto [u, chi] = binder_susceptibility(num_sites, beta, (total[0] - block[0]) / m, (total[1] - block[1]) / m, (total[2] - block[2]) / m);
+		binder_variance += std::pow(u - binder, 2);
+		susceptibility_variance += std::pow(chi - susceptibility, 2);
+	}
+
+	const double scale = static_cast<double>(num_blocks - 1) / static_cast<double>(num_blocks);
+	binder_error = std::sqrt(scale * binder_variance);
+	susceptibility_error = std::sqrt(scale * susceptibility_variance);
+}
+
+BinderScan::BinderScan(std::vector<size_t> lattice_sizes, const double beta, std::vector<double> grid, Measure measure)
+	: lattice_sizes(std::move(lattice_sizes)), beta(beta), grid(std::move(grid)), measure(std::move(measure)) {
+	assert(this->lattice_sizes.size() > 1 && this->grid.size() > 1);
+	std::ranges::sort(this->grid);
+}
+
+void BinderScan::measure_missing() {
+	std::vector<std::pair<size_t, double>> missing;
+	for (const size_t lattice_length : lattice_sizes) {
+		for (const double j : grid) {
+			if (!results.contains({ lattice_length, j })) missing.emplace_back(lattice_length, j);
+		}
+	}
+
+	std::mutex mutex;
+	std::for_each(std::execution::par, missing.begin(), missing.end(), [&] (const std::pair<size_t, double> & key) {
+		const std::vector<double> magnetizations = measure(key.first, key.second);
+		BinderPoint point { key.first, beta, key.second, magnetizations };
+
+		std::lock_guard guard { mutex };
+		results.emplace(key, point);
+	});
+}
+
+std::vector<BinderPoint> BinderScan::points(const size_t lattice_length) const {
+	std::vector<BinderPoint> result;
+	for (const double j : grid) {
+		if (const auto it = results.find({ lattice_length, j }); it != results.end()) result.push_back(it->second);
+	}
+	return result;
+}
+
+/**
+ * The difference of the Binder cumulants of the larger and the smaller lattice and its uncertainty.
+ */
+static std::pair<double, double> binder_difference(const BinderPoint & smaller, const BinderPoint & larger) {
+	return { larger.binder - smaller.binder, std::hypot(larger.binder_error, smaller.binder_error) };
+}
+
+/**
+ * Close to the crossing the statistical noise can produce several sign changes, which are merged into a single
+ * crossing whose uncertainty also covers their spread.
+ */
+std::vector<BinderCrossing> BinderScan::crossings() const {
+	std::vector<BinderCrossing> result;
+	for (const size_t l : std::views::iota(static_cast<size_t>(1), lattice_sizes.size())) {
+		const std::vector<BinderPoint> smaller = points(lattice_sizes[l - 1]), larger = points(lattice_sizes[l]);
+
+		std::vector<BinderCrossing> found;
+		for (const size_t k : std::views::iota(static_cast<size_t>(1), std::min(smaller.size(), larger.size()))) {
+			const auto [lhs, lhs_error] = binder_difference(smaller[k - 1], larger[k - 1]);
+			const auto [rhs, rhs_error] = binder_difference(smaller[k], larger[k]);
+			if (std::signbit(lhs) == std::signbit(rhs)) continue;
+
+			const double width = smaller[k].j - smaller[k - 1].j, weight = lhs / (lhs - rhs);
+			const double statistical = std::hypot((1.0 - weight) * lhs_error, weight * rhs_error) / (std::abs(rhs - lhs) / width);
+			found.push_back({ lattice_sizes[l - 1], lattice_sizes[l], smaller[k - 1].j + weight * width, std::max(statistical, width / 2.0) });
+		}
+		if (found.empty()) continue;
+
+		const auto [lowest, highest] = std::ranges::minmax(found, std::less(), &BinderCrossing::j);
+		BinderCrossing merged { lattice_sizes[l - 1], lattice_sizes[l], 0.0, (highest.j - lowest.j) / 2.0 };
+		for (const BinderCrossing & crossing : found) {
+			merged.j += crossing.j / static_cast<double>(found.size());
+			merged.uncertainty = std::max(merged.uncertainty, crossing.uncertainty);
+		}
+		result.push_back(merged);
+	}
+	return result;
+}
+
+/**
+ * Intervals are only bisected while their end points differ significantly, finer grids cannot resolve a crossing or
+ * peak below the statistical uncertainty of the individual points.
+ */
+std::vector<double> BinderScan::candidates(const double tolerance) const {
+	std::vector<double> result;
+	const auto bisect = [&] (const size_t k) {
+		if (k == 0 || k >= grid.size() || grid[k] - grid[k - 1] <= tolerance) return;
+		result.push_back((grid[k - 1] + grid[k]) / 2.0);
+	};
+
+	for (const size_t l : std::views::iota(static_cast<size_t>(1), lattice_sizes.size())) {
+		const std::vector<BinderPoint> smaller = points(lattice_sizes[l - 1]), larger = points(lattice_sizes[l]);
+
+		bool crossed = false;
+		size_t closest = 1;
+		double closest_distance = std::numeric_limits<double>::infinity();
+		for (const size_t k : std::views::iota(static_cast<size_t>(1), grid.size())) {
+			const auto [lhs, lhs_error] = binder_difference(smaller[k - 1], larger[k - 1]);
+			const auto [rhs, rhs_error] = binder_difference(smaller[k], larger[k]);
+			if (std::signbit(lhs) != std::signbit(rhs)) {
+				crossed = true;
+				if (std::abs(lhs) > lhs_error && std::abs(rhs) > rhs_error) bisect(k);
+			}
+			if (std::abs(lhs + rhs) < closest_distance) {
+				closest = k;
+				closest_distance = std::abs(lhs + rhs);
+			}
+		}
+
+		// Without a crossing on the current grid, the curves are closest where the crossing is most likely.
+		if (!crossed) bisect(closest);
+	}
+
+	for (const size_t lattice_length : lattice_sizes) {
+		const std::vector<BinderPoint> current = points(lattice_length);
+		const auto peak = std::ranges::max_element(current, std::less(), &BinderPoint::susceptibility);
+		const auto k = static_cast<size_t>(std::distance(current.begin(), peak));
+
+		for (const size_t neighbour : { k - 1, k + 1 }) {
+			if (neighbour >= current.size()) continue;
+			const double error = std::hypot(current[k].susceptibility_error, current[neighbour].susceptibility_error);
+			if (current[k].susceptibility - current[neighbour].susceptibility > error) bisect(std::max(k, neighbour));
+		}
+	}
+
+	std::ranges::sort(result);
+	const auto [first, last] = std::ranges::unique(result);
+	result.erase(first, last);
+	return result;
+}
+
+std::vector<BinderCrossing> BinderScan::refine(const double tolerance, const size_t max_rounds) {
+	measure_missing();
+	for (size_t round = 0; round < max_rounds; ++round) {
+		const std::vector<double> additional = candidates(tolerance);
+		if (additional.empty()) break;
+
+		grid.insert(grid.end(), additional.begin(), additional.end());
+		std::ranges::sort(grid);
+		measure_missing();
+	}
+	return crossings();
+}
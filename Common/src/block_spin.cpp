@@ -0,0 +1,238 @@
+#include "block_spin.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <ranges>
+#include <stdexcept>
+
+/**
+ * Moves the bits at the even positions of the word into the lower 32 bits.
+ */
+static uint64_t compress_even_bits(uint64_t word) {
+	word &= 0x5555555555555555;
+	word = (word | word >> 1) & 0x3333333333333333;
+	word = (word | word >> 2) & 0x0F0F0F0F0F0F0F0F;
+	word = (word | word >> 4) & 0x00FF00FF00FF00FF;
+	word = (word | word >> 8) & 0x0000FFFF0000FFFF;
+	return (word | word >> 16) & 0x00000000FFFFFFFF;
+}
+
+/**
+ * With the upper left spin a, the upper right spin b and the lower spins c and d of every block, the block spin is up
+ * if a and at least one other spin is up, which covers the ties, or if b, c and d are up.
+ */
+static std::vector<int8_t> block_spins_pairwise(const std::span<const int8_t> spins, const size_t lattice_length) {
+	const size_t blocked_length = lattice_length / 2, words_per_row = (lattice_length + 63) / 64;
+	std::vector<int8_t> blocked (blocked_length * blocked_length);
+	std::vector<uint64_t> upper (words_per_row), lower (words_per_row);
+
+	const auto pack = [&] (const size_t row, std::vector<uint64_t> & words) {
+		std::ranges::fill(words, 0);
+		for (size_t col = 0; col < lattice_length; ++col) {
+			words[col / 64] |= static_cast<uint64_t>(spins[row * lattice_length + col] > 0) << (col % 64);
+		}
+	};
+
+	for (size_t row = 0; row < blocked_length; ++row) {
+		pack(2 * row, upper);
+		pack(2 * row + 1, lower);
+
+		for (size_t w = 0; w < words_per_row; ++w) {
+			const uint64_t a = upper[w], b = upper[w] >> 1, c = lower[w], d = lower[w] >> 1;
+			const uint64_t majority = compress_even_bits((a & (b | c | d)) | (b & c & d));
+
+			for (size_t k = 0; k < 32 && 32 * w + k < blocked_length; ++k) {
+				blocked[row * blocked_length + 32 * w + k] = static_cast<int8_t>((majority >> k & 1) ? 1 : -1);
+			}
+		}
+	}
+	return blocked;
+}
+
+std::vector<int8_t> block_spins(const std::span<const int8_t> spins, const size_t lattice_length, const size_t block_size) {
+	assert(spins.size() == lattice_length * lattice_length && lattice_length % block_size == 0);
+	if (block_size == 2) return block_spins_pairwise(spins, lattice_length);
+
+	const size_t blocked_length = lattice_length / block_size;
+	std::vector<int8_t> blocked (blocked_length * blocked_length);
+	for (size_t row = 0; row < blocked_length; ++row) {
+		for (size_t col = 0; col < blocked_length; ++col) {
+			const size_t corner = row * block_size * lattice_length + col * block_size;
+
+			int sum = 0;
+			for (size_t y = 0; y < block_size; ++y) {
+				for (size_t x = 0; x < block_size; ++x) sum += spins[corner + y * lattice_length + x];
+			}
+			blocked[row * blocked_length + col] = static_cast<int8_t>(sum > 0 ? 1 : sum < 0 ? -1 : spins[corner]);
+		}
+	}
+	return blocked;
+}
+
+/**
+ * Solves B X = A in place by Gauss-Jordan elimination with partial pivoting, leaving X in A.
+ */
+static void solve(std::vector<std::vector<double>> & b, std::vector<std::vector<double>> & a) {
+	const size_t n = b.size();
+	for (size_t col = 0; col < n; ++col) {
+		const size_t pivot = *std::ranges::max_element(std::views::iota(col, n), {}, [&] (const size_t row) { return std::abs(b[row][col]); });
+		std::swap(b[col], b[pivot]);
+		std::swap(a[col], a[pivot]);
+
+		for (size_t row = 0; row < n; ++row) {
+			if (row == col) continue;
+			const double factor = b[row][col] / b[col][col];
+			for (size_t k = 0; k < n; ++k) {
+				b[row][k] -= factor * b[col][k];
+				a[row][k] -= factor * a[col][k];
+			}
+		}
+	}
+	for (size_t row = 0; row < n; ++row) {
+		for (double & value : a[row]) value /= b[row][row];
+	}
+}
+
+/**
+ * Finds the eigenvalue of largest modulus by power iteration, which converges quickly because the leading eigenvalue
+ * of the transformation is well separated from the irrelevant ones.
+ */
+static double leading_eigenvalue(const std::vector<std::vector<double>> & matrix) {
+	const size_t n = matrix.size();
+	std::vector<double> vector (n, 1.0), product (n);
+
+	double eigenvalue = 0.0;
+	for (size_t iteration = 0; iteration < 1000; ++iteration) {
+		for (size_t row = 0; row < n; ++row) {
+			product[row] = std::inner_product(matrix[row].begin(), matrix[row].end(), vector.begin(), 0.0);
+		}
+		eigenvalue = std::inner_product(vector.begin(), vector.end(), product.begin(), 0.0) / std::inner_product(vector.begin(), vector.end(), vector.begin(), 0.0);
+
+		const double norm = std::sqrt(std::inner_product(product.begin(), product.end(), product.begin(), 0.0));
+		if (norm == 0.0) return 0.0;
+		std::ranges::transform(product, vector.begin(), [=] (const double value) { return value / norm; });
+	}
+	return eigenvalue;
+}
+
+BlockSpinAnalysis::BlockSpinAnalysis(const size_t lattice_length, const size_t levels, const size_t block_size)
+	: lattice_length(lattice_length), levels(levels), block_size(block_size) {
+	size_t length = lattice_length;
+	for (size_t level = 0; level < levels; ++level) {
+		if (length % block_size != 0) {
+			throw std::runtime_error("The lattice length must be divisible by the block size on every level");
+		}
+		length /= block_size;
+	}
+	if (levels == 0 || length < 4) {
+		throw std::runtime_error("The blocked lattices must be at least 4 x 4");
+	}
+}
+
+void BlockSpinAnalysis::push(const std::span<const int8_t> spins) {
+	assert(spins.size() == lattice_length * lattice_length);
+	std::vector<int8_t> current (spins.begin(), spins.end());
+
+	size_t length = lattice_length;
+	for (size_t level = 0; level <= levels; ++level) {
+		operators.push_back(measure(current, length));
+		if (level == levels) break;
+
+		current = block_spins(current, length, block_size);
+		length /= block_size;
+	}
+}
+
+void BlockSpinAnalysis::merge(const BlockSpinAnalysis & other) {
+	assert(other.lattice_length == lattice_length && other.levels == levels && other.block_size == block_size);
+	operators.insert(operators.end(), other.operators.begin(), other.operators.end());
+}
+
+size_t BlockSpinAnalysis::size() const noexcept {
+	return operators.size() / (levels + 1);
+}
+
+BlockSpinAnalysis::Operators BlockSpinAnalysis::measure(const std::span<const int8_t> spins, const size_t lattice_length) {
+	Operators values {};
+	const auto at = [&] (const size_t row, const size_t col) -> int {
+		return spins[row % lattice_length * lattice_length + col % lattice_length];
+	};
+
+	for (size_t row = 0; row < lattice_length; ++row) {
+		for (size_t col = 0; col < lattice_length; ++col) {
+			const int s = at(row, col), right = at(row, col + 1), down = at(row + 1, col), diagonal = at(row + 1, col + 1);
+			values[0] += s * (right + down);
+			values[1] += s * (diagonal + at(row + 1, col + lattice_length - 1));
+			values[2] += s * (at(row, col + 2) + at(row + 2, col));
+			values[3] += s * right * down * diagonal;
+
+			values[4] += s;
+			values[5] += s * right * down + s * right * diagonal + s * down * diagonal + right * down * diagonal;
+		}
+	}
+	return values;
+}
+
+std::array<double, 2> BlockSpinAnalysis::estimate(const size_t level, const size_t skip_begin, const size_t skip_end) const {
+	const auto samples = static_cast<double>(size() - (skip_end - skip_begin));
+	std::array<double, 2> exponents {};
+
+	for (const bool even : { true, false }) {
+		const size_t offset = even ? 0 : NUM_EVEN, count = even ? NUM_EVEN : NUM_ODD;
+
+		Operators coarse_means {}, fine_means {};
+		std::vector<std::vector<double>> a (count, std::vector<double>(count)), b (count, std::vector<double>(count));
+		for (size_t sample = 0; sample < size(); ++sample) {
+			if (sample >= skip_begin && sample < skip_end) continue;
+			const Operators & fine = operators[sample * (levels + 1) + level], & coarse = operators[sample * (levels + 1) + level + 1];
+
+			for (size_t k = 0; k < count; ++k) {
+				coarse_means[k] += coarse[offset + k];
+				fine_means[k] += fine[offset + k];
+				for (size_t l = 0; l < count; ++l) {
+					a[k][l] += coarse[offset + k] * fine[offset + l];
+					b[k][l] += coarse[offset + k] * coarse[offset + l];
+				}
+			}
+		}
+
+		for (size_t k = 0; k < count; ++k) {
+			for (size_t l = 0; l < count; ++l) {
+				a[k][l] = a[k][l] / samples - (even ? coarse_means[k] * fine_means[l] / samples / samples : 0.0);
+				b[k][l] = b[k][l] / samples - (even ? coarse_means[k] * coarse_means[l] / samples / samples : 0.0);
+			}
+		}
+
+		solve(b, a);
+		const double eigenvalue = leading_eigenvalue(a);
+		exponents[even ? 0 : 1] = eigenvalue > 0.0 ? std::log(eigenvalue) / std::log(static_cast<double>(block_size)) : std::numeric_limits<double>::quiet_NaN();
+	}
+	return exponents;
+}
+
+std::vector<RenormalizationExponents> BlockSpinAnalysis::exponents(const size_t num_blocks) const {
+	assert(num_blocks > 1 && size() >= num_blocks);
+	const size_t block = size() / num_blocks;
+
+	std::vector<RenormalizationExponents> result;
+	for (size_t level = 0; level < levels; ++level) {
+		const auto [y_thermal, y_magnetic] = estimate(level, 0, 0);
+
+		std::vector<std::array<double, 2>> jackknife (num_blocks);
+		for (size_t k = 0; k < num_blocks; ++k) jackknife[k] = estimate(level, k * block, (k + 1) * block);
+
+		const auto error = [&] (const size_t index) {
+			double mean = 0.0, squares = 0.0;
+			for (const auto & estimates : jackknife) mean += estimates[index] / static_cast<double>(num_blocks);
+			for (const auto & estimates : jackknife) squares += std::pow(estimates[index] - mean, 2);
+			return std::sqrt(static_cast<double>(num_blocks - 1) / static_cast<double>(num_blocks) * squares);
+		};
+
+		const double y_thermal_error = error(0);
+		result.push_back({ level, y_thermal, y_thermal_error, 1.0 / y_thermal, y_thermal_error / (y_thermal * y_thermal), y_magnetic, error(1) });
+	}
+	return result;
+}
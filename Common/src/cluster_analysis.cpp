@@ -0,0 +1,154 @@
+#include "cluster_analysis.h"
+
+#include <algorithm>
+#include <cassert>
+#include <execution>
+#include <map>
+#include <numeric>
+#include <ranges>
+#include <utility>
+
+/**
+ * The minimum number of sites per stripe, smaller lattices are labelled by a single stripe.
+ */
+constexpr size_t MIN_STRIPE_SITES = 1 << 14;
+
+/**
+ * The displacement between two sites of the unwrapped lattice in rows and columns.
+ */
+struct Displacement {
+	int32_t row = 0, col = 0;
+
+	Displacement operator+(const Displacement & rhs) const { return { row + rhs.row, col + rhs.col }; }
+	Displacement operator-(const Displacement & rhs) const { return { row - rhs.row, col - rhs.col }; }
+	Displacement operator-() const { return { -row, -col }; }
+	bool operator==(const Displacement &) const = default;
+};
+
+/**
+ * The union-find forest of the sites. Every site stores its displacement relative to its parent, so every root knows
+ * where its members lie on the unwrapped lattice. A bond between two members of the same tree whose displacements
+ * disagree closes a loop around the torus, which marks the tree as wrapping.
+ */
+struct Forest {
+	std::vector<uint32_t> parents, sizes;
+	std::vector<Displacement> offsets;
+	std::vector<uint8_t> wrapping;
+};
+
+/**
+ * Returns the root of the site and the displacement of the site relative to it, and points every site on the path
+ * directly to the root. Only called on sites of the same stripe by concurrent labelling passes.
+ */
+static std::pair<uint32_t, Displacement> find(Forest & forest, uint32_t i) {
+	uint32_t root = i;
+	Displacement total;
+	while (forest.parents[root] != root) {
+		total = total + forest.offsets[root];
+		root = forest.parents[root];
+	}
+
+	Displacement remaining = total;
+	while (i != root && forest.parents[i] != root) {
+		const uint32_t next = forest.parents[i];
+		const Displacement step = forest.offsets[i];
+		forest.parents[i] = root;
+		forest.offsets[i] = remaining;
+		remaining = remaining - step;
+		i = next;
+	}
+	return { root, total };
+}
+
+/**
+ * Joins the trees of the bond from lhs to rhs, where rhs lies at the given displacement from lhs on the unwrapped
+ * lattice. Attaches the root of the smaller tree to the root of the larger one and accumulates the sizes at the new
+ * root.
+ */
+static void unite(Forest & forest, const uint32_t lhs, const uint32_t rhs, const Displacement bond) {
+	auto [a, a_offset] = find(forest, lhs);
+	const auto [b, b_offset] = find(forest, rhs);
+	if (a == b) {
+		if (a_offset + bond != b_offset) forest.wrapping[a] = 1;
+		return;
+	}
+
+	uint32_t child = b;
+	Displacement child_offset = a_offset + bond - b_offset;
+	if (forest.sizes[a] < forest.sizes[b]) {
+		std::swap(a, child);
+		child_offset = -child_offset;
+	}
+	forest.parents[child] = a;
+	forest.offsets[child] = child_offset;
+	forest.sizes[a] += forest.sizes[child];
+	forest.wrapping[a] |= forest.wrapping[child];
+}
+
+ClusterStatistics analyse_clusters(const std::span<const int8_t> spins, const size_t lattice_length, const int8_t spin) {
+	const size_t num_sites = lattice_length * lattice_length;
+	assert(lattice_length > 1 && spins.size() == num_sites);
+
+	Forest forest { std::vector<uint32_t>(num_sites), std::vector<uint32_t>(num_sites, 1), std::vector<Displacement>(num_sites), std::vector<uint8_t>(num_sites, 0) };
+	std::iota(forest.parents.begin(), forest.parents.end(), 0);
+	std::vector<uint32_t> & parents = forest.parents, & sizes = forest.sizes;
+
+	const size_t num_stripes = std::clamp(num_sites / MIN_STRIPE_SITES, static_cast<size_t>(1), lattice_length);
+	std::vector<size_t> stripes (num_stripes);
+	std::iota(stripes.begin(), stripes.end(), 0);
+
+	std::for_each(std::execution::par, stripes.begin(), stripes.end(), [&] (const size_t stripe) {
+		const size_t start = stripe * lattice_length / num_stripes, end = (stripe + 1) * lattice_length / num_stripes;
+
+		for (size_t row = start; row < end; ++row) {
+			for (size_t col = 0; col < lattice_length; ++col) {
+				const auto i = static_cast<uint32_t>(row * lattice_length + col);
+				if (col > 0 && spins[i] == spins[i - 1]) unite(forest, i, i - 1, { 0, -1 });
+				if (row > start && spins[i] == spins[i - lattice_length]) unite(forest, i, static_cast<uint32_t>(i - lattice_length), { -1, 0 });
+			}
+
+			const auto first = static_cast<uint32_t>(row * lattice_length), last = static_cast<uint32_t>(first + lattice_length - 1);
+			if (spins[first] == spins[last]) unite(forest, first, last, { 0, -1 });
+		}
+	});
+
+	// Merges the first row of every stripe with the row above, which includes the periodic boundary of row 0.
+	for (const size_t stripe : stripes) {
+		const size_t start = stripe * lattice_length / num_stripes, previous = (start + lattice_length - 1) % lattice_length;
+		for (size_t col = 0; col < lattice_length; ++col) {
+			const auto i = static_cast<uint32_t>(start * lattice_length + col), j = static_cast<uint32_t>(previous * lattice_length + col);
+			if (spins[i] == spins[j]) unite(forest, i, j, { -1, 0 });
+		}
+	}
+
+	ClusterStatistics statistics;
+	std::map<size_t, size_t> distribution;
+	uint32_t largest_root = 0;
+	double sum_squares = 0.0;
+
+	for (const auto i : std::views::iota(static_cast<uint32_t>(0), static_cast<uint32_t>(num_sites))) {
+		if (parents[i] != i || (spin != 0 && spins[i] != spin)) continue;
+		statistics.num_domains += 1;
+		distribution[sizes[i]] += 1;
+		sum_squares += static_cast<double>(sizes[i]) * sizes[i];
+
+		if (sizes[i] > statistics.largest) {
+			statistics.largest = sizes[i];
+			largest_root = i;
+		}
+	}
+	if (statistics.num_domains == 0) return statistics;
+
+	statistics.largest_fraction = static_cast<double>(statistics.largest) / static_cast<double>(num_sites);
+	statistics.mean_size = (sum_squares - static_cast<double>(statistics.largest) * statistics.largest) / static_cast<double>(num_sites);
+	for (const auto & [size, count] : distribution) statistics.size_distribution.push_back({ size, count });
+
+	statistics.percolating = forest.wrapping[largest_root] != 0;
+	return statistics;
+}
+
+ClusterStatistics analyse_clusters(const Lattice2D & lattice, const size_t sweeps, const int8_t spin) {
+	ClusterStatistics statistics = analyse_clusters(lattice.configuration(), lattice.length(), spin);
+	statistics.sweeps = sweeps;
+	return statistics;
+}
@@ -0,0 +1,136 @@
+#include "distribution.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <execution>
+#include <numeric>
+#include <optional>
+#include <ranges>
+
+#include "fft.h"
+
+/**
+ * Masses below this fraction of the largest mass are trimmed from the tails, smaller masses are dominated by the
+ * rounding errors of the FFT.
+ */
+constexpr double TRIM_THRESHOLD = 1e-13;
+
+DiscreteDistribution::DiscreteDistribution(const double origin, const double step, std::vector<double> masses) : origin(origin), step(step), masses(std::move(masses)) {
+	trim();
+}
+
+DiscreteDistribution DiscreteDistribution::from_pdf(const std::function<double(double)> & pdf, const double lower, const double upper, const size_t points) {
+	assert(points > 1 && upper > lower);
+	const double step = (upper - lower) / static_cast<double>(points - 1);
+
+	std::vector<double> masses (points);
+	for (const size_t k : std::views::iota(static_cast<size_t>(0), points)) {
+		masses[k] = pdf(lower + static_cast<double>(k) * step);
+	}
+	return { lower, step, std::move(masses) };
+}
+
+void DiscreteDistribution::trim() {
+	for (double & mass : masses) mass = std::max(0.0, mass);
+	const double threshold = TRIM_THRESHOLD * std::ranges::max(masses);
+	const auto first = std::ranges::find_if(masses, [=] (const double mass) { return mass > threshold; });
+	const auto last = std::ranges::find_if(masses | std::views::reverse, [=] (const double mass) { return mass > threshold; }).base();
+
+	origin += static_cast<double>(std::distance(masses.begin(), first)) * step;
+	masses = std::vector(first, last);
+
+	const double total = std::accumulate(masses.begin(), masses.end(), 0.0);
+	for (double & mass : masses) mass /= total;
+}
+
+DiscreteDistribution DiscreteDistribution::convolve(const DiscreteDistribution & other) const {
+	assert(std::abs(step - other.step) <= 1e-12 * step);
+	return { origin + other.origin, step, ::convolve(masses, other.masses) };
+}
+
+DiscreteDistribution DiscreteDistribution::power(size_t n) const {
+	assert(n > 0);
+	DiscreteDistribution base = *this;
+	std::optional<DiscreteDistribution> result;
+
+	while (true) {
+		if (n & 1) result = result ? result->convolve(base) : base;
+		if ((n >>= 1) == 0) break;
+		base = base.convolve(base);
+	}
+	return *result;
+}
+
+DiscreteDistribution DiscreteDistribution::scaled(const double factor) const {
+	assert(factor > 0.0);
+	return { origin * factor, step * factor, masses };
+}
+
+double DiscreteDistribution::moment(const size_t k) const {
+	double sum = 0.0;
+	for (const size_t i : std::views::iota(static_cast<size_t>(0), masses.size())) {
+		sum += masses[i] * std::pow(origin + static_cast<double>(i) * step, static_cast<double>(k));
+	}
+	return sum;
+}
+
+double DiscreteDistribution::central_moment(const size_t k) const {
+	const double mean = moment(1);
+	double sum = 0.0;
+	for (const size_t i : std::views::iota(static_cast<size_t>(0), masses.size())) {
+		sum += masses[i] * std::pow(origin + static_cast<double>(i) * step - mean, static_cast<double>(k));
+	}
+	return sum;
+}
+
+double DiscreteDistribution::cumulant(const size_t k) const {
+	assert(k >= 1 && k <= 4);
+	switch (k) {
+		case 1: return moment(1);
+		case 4: return central_moment(4) - 3.0 * std::pow(central_moment(2), 2);
+		default: return central_moment(k);
+	}
+}
+
+double DiscreteDistribution::moment_generating(const double t) const {
+	return std::exp(cumulant_generating(t));
+}
+
+/**
+ * The exponentials are taken relative to the largest exponent of the support, which avoids overflow for large |t|.
+ */
+double DiscreteDistribution::cumulant_generating(const double t) const {
+	const double last = origin + static_cast<double>(masses.size() - 1) * step;
+	const double shift = std::max(t * origin, t * last);
+
+	double sum = 0.0;
+	for (const size_t i : std::views::iota(static_cast<size_t>(0), masses.size())) {
+		sum += masses[i] * std::exp(t * (origin + static_cast<double>(i) * step) - shift);
+	}
+	return shift + std::log(sum);
+}
+
+std::vector<DistributionPoint> DiscreteDistribution::density() const {
+	std::vector<DistributionPoint> points (masses.size());
+	for (const size_t i : std::views::iota(static_cast<size_t>(0), masses.size())) {
+		points[i] = { origin + static_cast<double>(i) * step, masses[i] / step };
+	}
+	return points;
+}
+
+histogram::Histogram sample_means(const std::function<double()> & sample, const size_t num_terms, const size_t num_experiments, const double lower, const double upper, const size_t bins) {
+	assert(num_terms > 0 && upper > lower);
+	histogram::Histogram histogram { bins };
+
+	std::vector<size_t> experiments (num_experiments);
+	std::iota(experiments.begin(), experiments.end(), 0);
+	std::for_each(std::execution::par, experiments.begin(), experiments.end(), [&] ([[maybe_unused]] const size_t _) {
+		double sum = 0.0;
+		for (size_t i = 0; i < num_terms; ++i) sum += sample();
+
+		const double value = (sum / static_cast<double>(num_terms) - lower) / (upper - lower);
+		if (value >= 0.0 && value < 1.0) histogram.add(value);
+	});
+	return histogram;
+}
@@ -0,0 +1,79 @@
+#include "fft.h"
+
+#include <bit>
+#include <cassert>
+#include <numbers>
+#include <utility>
+
+void fft(const std::span<std::complex<double>> data, const bool inverse) {
+	const size_t n = data.size();
+	assert(std::has_single_bit(n));
+
+	for (size_t i = 1, j = 0; i < n; ++i) {
+		size_t bit = n >> 1;
+		for (; j & bit; bit >>= 1) j ^= bit;
+		j ^= bit;
+		if (i < j) std::swap(data[i], data[j]);
+	}
+
+	// The roots of unity are tabulated once, the stages of length len use every (n / len)-th root.
+	std::vector<std::complex<double>> roots (n / 2);
+	for (size_t k = 0; k < roots.size(); ++k) {
+		roots[k] = std::polar(1.0, (inverse ? 2.0 : -2.0) * std::numbers::pi * static_cast<double>(k) / static_cast<double>(n));
+	}
+
+	for (size_t len = 2; len <= n; len <<= 1) {
+		const size_t stride = n / len;
+		for (size_t i = 0; i < n; i += len) {
+			for (size_t k = 0; k < len / 2; ++k) {
+				const std::complex<double> u = data[i + k], v = data[i + k + len / 2] * roots[k * stride];
+				data[i + k] = u + v;
+				data[i + k + len / 2] = u - v;
+			}
+		}
+	}
+
+	if (inverse) {
+		for (std::complex<double> & value : data) value /= static_cast<double>(n);
+	}
+}
+
+void fft_2d(const std::span<std::complex<double>> data, const size_t rows, const bool inverse) {
+	assert(rows > 0 && data.size() % rows == 0);
+	const size_t cols = data.size() / rows;
+
+	for (size_t row = 0; row < rows; ++row) fft(data.subspan(row * cols, cols), inverse);
+
+	std::vector<std::complex<double>> column (rows);
+	for (size_t col = 0; col < cols; ++col) {
+		for (size_t row = 0; row < rows; ++row) column[row] = data[row * cols + col];
+		fft(column, inverse);
+		for (size_t row = 0; row < rows; ++row) data[row * cols + col] = column[row];
+	}
+}
+
+/**
+ * Both real sequences are packed into the real and imaginary parts of a single complex sequence, so the convolution
+ * only needs one forward and one inverse transform.
+ */
+std::vector<double> convolve(const std::span<const double> lhs, const std::span<const double> rhs) {
+	if (lhs.empty() || rhs.empty()) return {};
+	const size_t size = lhs.size() + rhs.size() - 1, n = std::bit_ceil(size);
+
+	std::vector<std::complex<double>> packed (n);
+	for (size_t i = 0; i < lhs.size(); ++i) packed[i].real(lhs[i]);
+	for (size_t i = 0; i < rhs.size(); ++i) packed[i].imag(rhs[i]);
+	fft(packed);
+
+	// With z = a + ib the product of the transforms of a and b is (Z(k)^2 - conj(Z(n - k))^2) / 4i.
+	std::vector<std::complex<double>> product (n);
+	for (size_t k = 0; k < n; ++k) {
+		const std::complex<double> z = packed[k], w = std::conj(packed[(n - k) % n]);
+		product[k] = (z * z - w * w) / std::complex<double>(0.0, 4.0);
+	}
+	fft(product, true);
+
+	std::vector<double> result (size);
+	for (size_t i = 0; i < size; ++i) result[i] = product[i].real();
+	return result;
+}
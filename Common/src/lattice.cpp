@@ -1,23 +1,72 @@
 #include <cmath>
 #include <algorithm>
-#include <random>
 #include <ranges>
 #include <limits>
+#include <utility>
 
 #include "lattice.h"
 
 #include <iostream>
 #include <memory>
+#include <vector>
 
-/**
- * The Mersenne Twister 19937 uniform random number generator with random seed.
- */
-static thread_local std::mt19937 generator {std::random_device()()};
+#include "random_buffer.h"
+#include "trace.h"
 
 /**
- * A uniform distribution [0, 1] from which the generate can sample.
+ * Checks whether the means of two consecutive windows of measurements differ by more than two standard errors. The
+ * errors are corrected by the integrated autocorrelation times of the windows, since consecutive sweeps are strongly
+ * correlated near the critical point and the naive errors would report drift which is only noise.
  */
-static std::uniform_real_distribution uniform_distribution {0.0, 1.0};
+static bool has_drifted(const std::span<const double> previous, const std::span<const double> current) {
+    const ObservableEstimate lhs { previous }, rhs { current };
+    return std::abs(lhs.mean - rhs.mean) > 2.0 * std::hypot(lhs.error, rhs.error);
+}
+
+void Lattice::initialize() {
+    current_bonds = bond_sum();
+    current_spins = spin_sum();
+    update_acceptances();
+}
+
+void Lattice::update_acceptances() {
+    max_diff_bonds = 2 * coordination();
+    acceptances.resize(3 * (2 * max_diff_bonds + 1));
+    thresholds.resize(acceptances.size());
+    for (const int diff_bonds : std::views::iota(-max_diff_bonds, max_diff_bonds + 1)) {
+        for (const int diff_field : { -2, 0, 2 }) {
+            const size_t index = 3 * (diff_bonds + max_diff_bonds) + diff_field / 2 + 1;
+            acceptances.at(index) = std::min(1.0, std::exp(-action_diff(-j * diff_bonds, diff_field)));
+            thresholds.at(index) = RandomBuffer::threshold(acceptances.at(index));
+        }
+    }
+}
+
+void Lattice::flip(const size_t i) {
+    current_bonds += bond_sum_diff(i);
+    current_spins += spin_sum_diff(i);
+    flip_spin(i);
+}
+
+int Lattice::field_sum_diff(const size_t i) const {
+    return spin_sum_diff(i);
+}
+
+double Lattice::energy() const {
+    return -j * static_cast<double>(bond_sum());
+}
+
+double Lattice::energy_diff(const size_t i) const {
+    return -j * bond_sum_diff(i);
+}
+
+double Lattice::magnetization() const {
+    return static_cast<double>(spin_sum());
+}
+
+double Lattice::magnetization_diff(const size_t i) const {
+    return spin_sum_diff(i);
+}
 
 double Lattice::action() const {
     return beta * (energy() - h * magnetization());
@@ -32,32 +81,109 @@ double Lattice::action_diff(const double diff_energy, const double diff_magnetiz
 }
 
 double Lattice::acceptance(const size_t i) const noexcept {
-    return std::min(1.0, std::exp(-action_diff(i)));
+    return acceptance(bond_sum_diff(i), field_sum_diff(i));
 }
 
-double Lattice::acceptance(const double diff_energy, double const diff_magnetization) const {
-    return std::min(1.0, std::exp(-action_diff(diff_energy, diff_magnetization)));
+double Lattice::acceptance(const int diff_bonds, const int diff_field) const noexcept {
+    return acceptances[3 * (diff_bonds + max_diff_bonds) + diff_field / 2 + 1];
 }
 
-std::generator<LatticeObservable> Lattice::sweeps() {
-    while (current.sweeps < std::numeric_limits<size_t>::max()) {
-        current.sweeps += 1;
-        for (const size_t i : std::views::iota(static_cast<size_t>(0), num_sites())) {
-            const double diff_energy = energy_diff(i);
-            const double diff_magnetization = magnetization_diff(i);
+uint64_t Lattice::threshold(const int diff_bonds, const int diff_field) const noexcept {
+    return thresholds[3 * (diff_bonds + max_diff_bonds) + diff_field / 2 + 1];
+}
 
-            if (acceptance(diff_energy, diff_magnetization) > uniform_distribution(generator)) {
-                current.energy += diff_energy;
-                current.magnetization += diff_magnetization;
-                flip_spin(i);
-            }
+LatticeObservable Lattice::observable() const {
+    return { current_sweeps, j, -j * static_cast<double>(current_bonds), static_cast<double>(current_spins) };
+}
+
+void Lattice::sweep() {
+    current_sweeps += 1;
+    RandomBuffer & random = RandomBuffer::local();
+    for (const size_t i : std::views::iota(static_cast<size_t>(0), num_sites())) {
+        const int diff_bonds = bond_sum_diff(i);
+        const int diff_spins = spin_sum_diff(i);
+
+        if (random.accept(threshold(diff_bonds, diff_spins))) {
+            current_bonds += diff_bonds;
+            current_spins += diff_spins;
+            flip_spin(i);
         }
-        co_yield current;
     }
 }
 
 LatticeObservable Lattice::metropolis_hastings(const size_t num_sweeps) {
-    return std::ranges::fold_left(sweeps() | std::views::take(num_sweeps), LatticeObservable(), [] (const auto sum, const auto current) {
-        return sum + current;
-    }) / (num_sites() * num_sweeps);
+    int64_t sum_bonds = 0, sum_spins = 0;
+    for (size_t i = 0; i < num_sweeps; ++i) {
+        sweep();
+        sum_bonds += current_bonds;
+        sum_spins += current_spins;
+    }
+    return LatticeObservable { current_sweeps, j, -j * static_cast<double>(sum_bonds), static_cast<double>(sum_spins) } / (num_sites() * num_sweeps);
+}
+
+/**
+ * The errors are only recalculated once the series has grown by a quarter since the last check, so the FFTs of the
+ * autocorrelation functions stay a small fraction of the sweeps for long runs.
+ */
+AdaptiveResult Lattice::run_until(const double parameter, const ErrorTarget & target) {
+    assert(target.block_sweeps > 1);
+    const TraceSpan span { "run_until", { { "parameter", parameter } } };
+    const auto sites = static_cast<double>(num_sites());
+
+    std::vector<double> energies, magnetizations;
+    size_t next_check = target.block_sweeps;
+
+    while (true) {
+        const size_t num_sweeps = std::min(target.block_sweeps, target.max_sweeps - energies.size());
+        run(num_sweeps, [&] (const std::span<const LatticeObservable> block) {
+            for (const LatticeObservable & observable : block) {
+                energies.push_back(observable.energy / sites);
+                magnetizations.push_back((target.absolute_magnetization ? std::abs(observable.magnetization) : observable.magnetization) / sites);
+            }
+        });
+
+        const bool exhausted = energies.size() >= target.max_sweeps;
+        if (energies.size() < next_check && !exhausted) continue;
+        next_check = std::max(energies.size() + target.block_sweeps, energies.size() * 5 / 4);
+
+        const ObservableEstimate energy { energies }, magnetization { magnetizations };
+        const bool energy_done = std::isinf(target.energy) || (energy.error <= target.energy && energy.reliable(energies.size()));
+        const bool magnetization_done = std::isinf(target.magnetization) || (magnetization.error <= target.magnetization && magnetization.reliable(magnetizations.size()));
+
+        if ((energy_done && magnetization_done) || exhausted) {
+            return AdaptiveResult { parameter, energies.size(), energy, magnetization, energy_done && magnetization_done ? StopReason::TargetReached : StopReason::BudgetExhausted };
+        }
+    }
+}
+
+void Lattice::anneal(const double beta, const double j, const double h) {
+    this->beta = beta;
+    this->j = j;
+    this->h = h;
+    update_acceptances();
+}
+
+size_t Lattice::equilibrate(const size_t window, const size_t max_sweeps) {
+    assert(window > 1);
+    std::vector<double> energies, magnetizations, previous_energies, previous_magnetizations;
+
+    size_t discarded = 0;
+    while (discarded < max_sweeps) {
+        const size_t num_sweeps = std::min(window, max_sweeps - discarded);
+        run(num_sweeps, [&] (const std::span<const LatticeObservable> block) {
+            for (const LatticeObservable & observable : block) {
+                energies.push_back(observable.energy);
+                magnetizations.push_back(observable.magnetization);
+            }
+        });
+        discarded += num_sweeps;
+
+        if (discarded == max_sweeps) break;
+        if (!previous_energies.empty() && !has_drifted(previous_energies, energies) && !has_drifted(previous_magnetizations, magnetizations)) {
+            break;
+        }
+        previous_energies = std::exchange(energies, {});
+        previous_magnetizations = std::exchange(magnetizations, {});
+    }
+    return discarded;
 }
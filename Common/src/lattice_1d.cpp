@@ -10,21 +10,25 @@ constexpr size_t Lattice1D::num_sites() const noexcept {
     return spins.size();
 }
 
-double Lattice1D::energy() const {
-    int energy = 0;
+int Lattice1D::coordination() const noexcept {
+    return 2;
+}
+
+int64_t Lattice1D::bond_sum() const {
+    int64_t bonds = 0;
     for (const size_t i : std::views::iota(static_cast<size_t>(0), spins.size()))
     {
-        energy += spins.at(i) * spins.at((i + 1) % spins.size());
+        bonds += spins.at(i) * spins.at((i + 1) % spins.size());
     }
-    return -j * energy;
+    return bonds;
 }
 
-double Lattice1D::energy_diff(const size_t i) const {
-    return 2 * j * spins.at(i) * (spins.at((i + 1) % spins.size()) + spins.at((i + spins.size() - 1) % spins.size()));
+int Lattice1D::bond_sum_diff(const size_t i) const {
+    return -2 * spins.at(i) * (spins.at((i + 1) % spins.size()) + spins.at((i + spins.size() - 1) % spins.size()));
 }
 
-double Lattice1D::magnetization() const {
-    int magnetization = 0;
+int64_t Lattice1D::spin_sum() const {
+    int64_t magnetization = 0;
     for (const int8_t spin : spins)
     {
         magnetization += spin;
@@ -32,10 +36,10 @@ double Lattice1D::magnetization() const {
     return magnetization;
 }
 
-double Lattice1D::magnetization_diff(const size_t i) const {
-    return magnetization_diff(spins.at(i));
+int Lattice1D::spin_sum_diff(const size_t i) const {
+    return spin_sum_diff(spins.at(i));
 }
 
-double Lattice1D::magnetization_diff(const int8_t old_spin) {
+int Lattice1D::spin_sum_diff(const int8_t old_spin) {
     return -2 * old_spin;
 }
@@ -0,0 +1,254 @@
+#include "lattice_graph.h"
+
+#include <algorithm>
+#include <cassert>
+#include <execution>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <ranges>
+
+#include "random_buffer.h"
+
+/**
+ * Lists the bonds of a periodic square lattice with the couplings drawn from the given function.
+ */
+template<typename F>
+static std::vector<Bond> square_bonds(const size_t lattice_length, F && coupling) {
+	std::vector<Bond> bonds;
+	for (const size_t i : std::views::iota(static_cast<size_t>(0), lattice_length * lattice_length)) {
+		const size_t row = i / lattice_length, col = i % lattice_length;
+		bonds.push_back({ static_cast<uint32_t>(i), static_cast<uint32_t>(row * lattice_length + (col + 1) % lattice_length), coupling() });
+		bonds.push_back({ static_cast<uint32_t>(i), static_cast<uint32_t>((row + 1) % lattice_length * lattice_length + col), coupling() });
+	}
+	return bonds;
+}
+
+GraphLattice::GraphLattice(const size_t num_sites, const std::vector<Bond> & bonds, const double beta, const double j, const double h, const std::vector<int8_t> & site_fields)
+	: Lattice(beta, j, h), to_original(reverse_cuthill_mckee(num_sites, bonds)), fields(num_sites, 1), spins(num_sites, 1) {
+	assert(site_fields.empty() || site_fields.size() == num_sites);
+	to_internal.resize(num_sites);
+	for (const uint32_t i : std::views::iota(static_cast<uint32_t>(0), static_cast<uint32_t>(num_sites))) {
+		to_internal.at(to_original.at(i)) = i;
+		if (!site_fields.empty()) fields.at(i) = site_fields.at(to_original.at(i));
+	}
+
+	offsets.assign(num_sites + 1, 0);
+	for (const Bond & bond : bonds) {
+		offsets.at(to_internal.at(bond.first) + 1) += 1;
+		offsets.at(to_internal.at(bond.second) + 1) += 1;
+	}
+	std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+	neighbours.resize(offsets.back());
+	couplings.resize(offsets.back());
+	std::vector<uint32_t> fill (offsets.begin(), offsets.end() - 1);
+	for (const Bond & bond : bonds) {
+		const uint32_t first = to_internal.at(bond.first), second = to_internal.at(bond.second);
+		neighbours.at(fill.at(first)) = second;
+		couplings.at(fill.at(first)++) = bond.coupling;
+		neighbours.at(fill.at(second)) = first;
+		couplings.at(fill.at(second)++) = bond.coupling;
+	}
+
+	for (const uint32_t i : std::views::iota(static_cast<uint32_t>(0), static_cast<uint32_t>(num_sites))) {
+		int coupling_sum = 0;
+		for (uint32_t k = offsets[i]; k < offsets[i + 1]; ++k) coupling_sum += std::abs(couplings[k]);
+		max_coupling_sum = std::max(max_coupling_sum, coupling_sum);
+	}
+
+	colour_greedily();
+	initialize();
+}
+
+GraphLattice GraphLattice::edwards_anderson(const size_t lattice_length, const double beta, const double j, const double h, const uint64_t seed) {
+	std::mt19937_64 generator { seed };
+	std::bernoulli_distribution sign { 0.5 };
+	const std::vector<Bond> bonds = square_bonds(lattice_length, [&] { return static_cast<int8_t>(sign(generator) ? 1 : -1); });
+	return { lattice_length * lattice_length, bonds, beta, j, h };
+}
+
+GraphLattice GraphLattice::diluted(const size_t lattice_length, const double occupation, const double beta, const double j, const double h, const uint64_t seed) {
+	std::mt19937_64 generator { seed };
+	std::bernoulli_distribution occupied { occupation };
+	std::vector<Bond> bonds = square_bonds(lattice_length, [&] { return static_cast<int8_t>(occupied(generator)); });
+	std::erase_if(bonds, [] (const Bond & bond) { return bond.coupling == 0; });
+	return { lattice_length * lattice_length, bonds, beta, j, h };
+}
+
+/**
+ * Starts a breadth first search at a site of minimal degree in every connected component and visits the neighbours in
+ * order of increasing degree. Reversing the visiting order yields a narrow bandwidth of the adjacency matrix.
+ */
+std::vector<uint32_t> GraphLattice::reverse_cuthill_mckee(const size_t num_sites, const std::vector<Bond> & bonds) {
+	std::vector<std::vector<uint32_t>> adjacency (num_sites);
+	for (const Bond & bond : bonds) {
+		adjacency.at(bond.first).push_back(bond.second);
+		adjacency.at(bond.second).push_back(bond.first);
+	}
+	for (std::vector<uint32_t> & sites : adjacency) {
+		std::ranges::sort(sites, [&] (const uint32_t lhs, const uint32_t rhs) { return adjacency[lhs].size() < adjacency[rhs].size(); });
+	}
+
+	std::vector<uint32_t> by_degree (num_sites);
+	std::iota(by_degree.begin(), by_degree.end(), 0);
+	std::ranges::stable_sort(by_degree, [&] (const uint32_t lhs, const uint32_t rhs) { return adjacency[lhs].size() < adjacency[rhs].size(); });
+
+	std::vector<uint32_t> order;
+	std::vector<bool> visited (num_sites, false);
+	order.reserve(num_sites);
+	for (const uint32_t start : by_degree) {
+		if (visited[start]) continue;
+
+		std::queue<uint32_t> queue;
+		queue.push(start);
+		visited[start] = true;
+		while (!queue.empty()) {
+			const uint32_t site = queue.front();
+			queue.pop();
+			order.push_back(site);
+			for (const uint32_t neighbour : adjacency[site]) {
+				if (visited[neighbour]) continue;
+				visited[neighbour] = true;
+				queue.push(neighbour);
+			}
+		}
+	}
+
+	std::ranges::reverse(order);
+	return order;
+}
+
+void GraphLattice::colour_greedily() {
+	std::vector<uint32_t> colour_of (spins.size());
+	std::vector<bool> taken;
+	for (const uint32_t i : std::views::iota(static_cast<uint32_t>(0), static_cast<uint32_t>(spins.size()))) {
+		taken.assign(colours.size() + 1, false);
+		for (uint32_t k = offsets[i]; k < offsets[i + 1]; ++k) {
+			if (neighbours[k] < i) taken[colour_of[neighbours[k]]] = true;
+		}
+
+		colour_of[i] = static_cast<uint32_t>(std::ranges::find(taken, false) - taken.begin());
+		if (colour_of[i] == colours.size()) colours.emplace_back();
+		colours[colour_of[i]].push_back(i);
+	}
+}
+
+void GraphLattice::flip_spin(const size_t i) {
+	spins.at(to_internal.at(i)) *= -1;
+}
+
+constexpr size_t GraphLattice::num_sites() const noexcept {
+	return spins.size();
+}
+
+int GraphLattice::coordination() const noexcept {
+	return max_coupling_sum;
+}
+
+int64_t GraphLattice::bond_sum() const {
+	int64_t bonds = 0;
+	for (const uint32_t i : std::views::iota(static_cast<uint32_t>(0), static_cast<uint32_t>(spins.size()))) {
+		for (uint32_t k = offsets[i]; k < offsets[i + 1]; ++k) {
+			if (neighbours[k] > i) bonds += couplings[k] * spins[i] * spins[neighbours[k]];
+		}
+	}
+	return bonds;
+}
+
+int GraphLattice::bond_sum_diff(const size_t i) const {
+	const uint32_t site = to_internal.at(i);
+	int local = 0;
+	for (uint32_t k = offsets[site]; k < offsets[site + 1]; ++k) {
+		local += couplings[k] * spins[neighbours[k]];
+	}
+	return -2 * spins[site] * local;
+}
+
+int64_t GraphLattice::spin_sum() const {
+	int64_t magnetization = 0;
+	for (const int8_t spin : spins) {
+		magnetization += spin;
+	}
+	return magnetization;
+}
+
+int GraphLattice::spin_sum_diff(const size_t i) const {
+	return -2 * spins.at(to_internal.at(i));
+}
+
+int GraphLattice::field_sum_diff(const size_t i) const {
+	return site_field_sum_diff(to_internal.at(i));
+}
+
+int GraphLattice::site_field_sum_diff(const uint32_t site) const {
+	return -2 * fields[site] * spins[site];
+}
+
+double GraphLattice::action() const {
+	int64_t field_sum = 0;
+	for (const size_t i : std::views::iota(static_cast<size_t>(0), spins.size())) {
+		field_sum += fields[i] * spins[i];
+	}
+	return beta * (energy() - h * static_cast<double>(field_sum));
+}
+
+double GraphLattice::action_diff(const size_t i) const {
+	return Lattice::action_diff(energy_diff(i), field_sum_diff(i));
+}
+
+size_t GraphLattice::num_colours() const noexcept {
+	return colours.size();
+}
+
+std::pair<int64_t, int64_t> GraphLattice::update(const uint32_t site, RandomBuffer & random) {
+	int local = 0;
+	for (uint32_t k = offsets[site]; k < offsets[site + 1]; ++k) {
+		local += couplings[k] * spins[neighbours[k]];
+	}
+
+	const int diff_bonds = -2 * spins[site] * local;
+	if (!random.accept(threshold(diff_bonds, site_field_sum_diff(site)))) return { 0, 0 };
+
+	spins[site] *= -1;
+	return { diff_bonds, 2 * spins[site] };
+}
+
+void GraphLattice::sweep() {
+	current_sweeps += 1;
+
+	const auto add = [] (const std::pair<int64_t, int64_t> & lhs, const std::pair<int64_t, int64_t> & rhs) -> std::pair<int64_t, int64_t> {
+		return { lhs.first + rhs.first, lhs.second + rhs.second };
+	};
+
+	RandomBuffer & random = RandomBuffer::local();
+	if (spins.size() < PARALLEL_SITES) {
+		for (const std::vector<uint32_t> & colour : colours) {
+			const auto [diff_bonds, diff_spins] = std::transform_reduce(colour.begin(), colour.end(), std::pair<int64_t, int64_t>(), add, [&] (const uint32_t site) {
+				return update(site, random);
+			});
+			current_bonds += diff_bonds;
+			current_spins += diff_spins;
+		}
+		return;
+	}
+
+	const uint64_t sweep_seed = random.next();
+	std::vector<uint64_t> chunks;
+	for (size_t c = 0; c < colours.size(); ++c) {
+		const std::vector<uint32_t> & colour = colours[c];
+		chunks.resize((colour.size() + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK);
+		std::iota(chunks.begin(), chunks.end(), static_cast<uint64_t>(0));
+
+		const auto [diff_bonds, diff_spins] = std::transform_reduce(std::execution::par, chunks.begin(), chunks.end(), std::pair<int64_t, int64_t>(), add, [&] (const uint64_t chunk) {
+			RandomBuffer random { sweep_seed, static_cast<uint64_t>(c) << 32 | chunk };
+			std::pair<int64_t, int64_t> diff {};
+			for (size_t k = chunk * PARALLEL_CHUNK; k < std::min(colour.size(), (chunk + 1) * PARALLEL_CHUNK); ++k) {
+				diff = add(diff, update(colour[k], random));
+			}
+			return diff;
+		});
+		current_bonds += diff_bonds;
+		current_spins += diff_spins;
+	}
+}
@@ -0,0 +1,149 @@
+#include "lattice_long_range.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <ranges>
+#include <stdexcept>
+
+#include "fft.h"
+#include "random_buffer.h"
+
+LongRangeLattice::LongRangeLattice(const size_t lattice_length, const double alpha, const double beta, const double j, const double h, const Update update, const size_t cluster_updates)
+	: lattice_length(lattice_length), alpha(alpha), beta(beta), j(j), h(h), update(update), cluster_updates(cluster_updates), current_spins(static_cast<int64_t>(num_sites())),
+	  spins(num_sites(), 1), fields(num_sites()), kernel(num_sites()), kernel_transform(num_sites()), cumulative_bonds(num_sites()), in_cluster(num_sites(), 0) {
+	assert(std::has_single_bit(lattice_length));
+	if (update == Update::Cluster && j < 0.0) {
+		throw std::runtime_error("The cluster update requires ferromagnetic coupling");
+	}
+
+	for (const size_t dy : std::views::iota(static_cast<size_t>(0), lattice_length)) {
+		for (const size_t dx : std::views::iota(static_cast<size_t>(0), lattice_length)) {
+			const auto x = static_cast<double>(std::min(dx, lattice_length - dx)), y = static_cast<double>(std::min(dy, lattice_length - dy));
+			kernel[dy * lattice_length + dx] = dx == 0 && dy == 0 ? 0.0 : std::pow(x * x + y * y, -alpha / 2.0);
+		}
+	}
+	std::ranges::copy(kernel, kernel_transform.begin());
+	fft_2d(kernel_transform, lattice_length);
+
+	// Bonds between aligned spins are activated with probability 1 - exp(-2 beta j K), so the probability that none of
+	// the offsets n + 1 ... m is activated is exp(-(cumulative_bonds[m] - cumulative_bonds[n])).
+	for (size_t n = 1; n < num_sites(); ++n) {
+		cumulative_bonds[n] = cumulative_bonds[n - 1] + 2.0 * beta * j * kernel[n];
+	}
+
+	update_fields();
+}
+
+size_t LongRangeLattice::num_sites() const noexcept {
+	return lattice_length * lattice_length;
+}
+
+double LongRangeLattice::energy() const {
+	double bonds = 0.0;
+	for (const size_t i : std::views::iota(static_cast<size_t>(0), num_sites())) {
+		bonds += spins[i] * fields[i];
+	}
+	return -j * bonds / 2.0 - h * magnetization();
+}
+
+double LongRangeLattice::magnetization() const {
+	return static_cast<double>(current_spins);
+}
+
+double LongRangeLattice::energy_diff(const size_t i) const {
+	return 2.0 * spins[i] * (j * fields[i] + h);
+}
+
+LatticeObservable LongRangeLattice::observable() const {
+	return { current_sweeps, j, energy(), magnetization() };
+}
+
+/**
+ * The fields of every row are shifted by the same row of the kernel, which is split into two contiguous ranges at the
+ * periodic boundary so the inner loops vectorize.
+ */
+void LongRangeLattice::flip_spin(const size_t i) {
+	const double delta = -2.0 * spins[i];
+	spins[i] = static_cast<int8_t>(-spins[i]);
+	current_spins += static_cast<int64_t>(delta);
+
+	const size_t row = i / lattice_length, col = i % lattice_length;
+	for (const size_t y : std::views::iota(static_cast<size_t>(0), lattice_length)) {
+		const double * const shifted = kernel.data() + (y + lattice_length - row) % lattice_length * lattice_length;
+		double * const target = fields.data() + y * lattice_length;
+		for (size_t x = col; x < lattice_length; ++x) target[x] += delta * shifted[x - col];
+		for (size_t x = 0; x < col; ++x) target[x] += delta * shifted[x + lattice_length - col];
+	}
+}
+
+void LongRangeLattice::update_fields() {
+	std::vector<std::complex<double>> transform (num_sites());
+	std::ranges::copy(spins, transform.begin());
+	fft_2d(transform, lattice_length);
+
+	for (size_t k = 0; k < num_sites(); ++k) transform[k] *= kernel_transform[k];
+	fft_2d(transform, lattice_length, true);
+
+	std::ranges::transform(transform, fields.begin(), [] (const std::complex<double> & value) { return value.real(); });
+}
+
+void LongRangeLattice::metropolis_sweep() {
+	RandomBuffer & random = RandomBuffer::local();
+	for (const size_t i : std::views::iota(static_cast<size_t>(0), num_sites())) {
+		const double diff = energy_diff(i);
+		if (diff <= 0.0 || std::exp(-beta * diff) > random.uniform()) {
+			flip_spin(i);
+		}
+	}
+}
+
+/**
+ * For every member the next activated bond is found by drawing an exponential variate and searching the cumulative
+ * bond probabilities, so only the activated bonds are visited. The field is taken into account by accepting the flip
+ * of the whole cluster with the Metropolis probability of its Zeeman energy.
+ */
+size_t LongRangeLattice::cluster_update() {
+	RandomBuffer & random = RandomBuffer::local();
+	const auto origin = static_cast<uint32_t>(std::min(static_cast<size_t>(random.uniform() * static_cast<double>(num_sites())), num_sites() - 1));
+	const int8_t spin = spins[origin];
+
+	cluster.assign(1, origin);
+	in_cluster[origin] = 1;
+
+	for (size_t member = 0; member < cluster.size(); ++member) {
+		const size_t row = cluster[member] / lattice_length, col = cluster[member] % lattice_length;
+		for (size_t n = 0; ; ) {
+			const double target = cumulative_bonds[n] - std::log1p(-random.uniform());
+			const auto next = std::lower_bound(cumulative_bonds.begin() + static_cast<std::ptrdiff_t>(n) + 1, cumulative_bonds.end(), target);
+			if (next == cumulative_bonds.end()) break;
+
+			n = static_cast<size_t>(next - cumulative_bonds.begin());
+			const size_t k = (row + n / lattice_length) % lattice_length * lattice_length + (col + n % lattice_length) % lattice_length;
+			if (spins[k] == spin && !in_cluster[k]) {
+				in_cluster[k] = 1;
+				cluster.push_back(static_cast<uint32_t>(k));
+			}
+		}
+	}
+
+	const double diff = 2.0 * h * spin * static_cast<double>(cluster.size());
+	const bool accepted = diff <= 0.0 || std::exp(-beta * diff) > random.uniform();
+	for (const uint32_t k : cluster) {
+		in_cluster[k] = 0;
+		if (accepted) spins[k] = static_cast<int8_t>(-spin);
+	}
+	if (accepted) current_spins -= 2 * spin * static_cast<int64_t>(cluster.size());
+	return cluster.size();
+}
+
+void LongRangeLattice::sweep() {
+	current_sweeps += 1;
+	if (update == Update::Metropolis) {
+		metropolis_sweep();
+	} else {
+		for (size_t i = 0; i < cluster_updates; ++i) cluster_update();
+	}
+	update_fields();
+}
@@ -0,0 +1,273 @@
+#include "lattice_on.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <ranges>
+
+/**
+ * Samples an XY spin from the distribution exp(beta s * field). The angle to the field follows the von Mises
+ * distribution, which is sampled with the algorithm of Best and Fisher.
+ */
+static std::array<float, 2> sample_von_mises(const std::array<float, 2> & field, const double beta, RandomBuffer & random) {
+	const double norm = std::sqrt(field[0] * field[0] + field[1] * field[1]), kappa = beta * norm;
+	if (kappa < 1e-6) {
+		const double phi = 2.0 * std::numbers::pi * random.uniform();
+		return { static_cast<float>(std::cos(phi)), static_cast<float>(std::sin(phi)) };
+	}
+	const double axis[2] { field[0] / norm, field[1] / norm };
+
+	const double tau = 1.0 + std::sqrt(1.0 + 4.0 * kappa * kappa);
+	const double rho = (tau - std::sqrt(2.0 * tau)) / (2.0 * kappa);
+	const double r = (1.0 + rho * rho) / (2.0 * rho);
+
+	double f;
+	while (true) {
+		const double z = std::cos(std::numbers::pi * random.uniform());
+		const double u = std::max(random.uniform(), std::numeric_limits<double>::min());
+		f = (1.0 + r * z) / (r + z);
+		const double c = kappa * (r - f);
+		if (c * (2.0 - c) - u > 0.0 || std::log(c / u) + 1.0 - c >= 0.0) break;
+	}
+	const double theta = std::copysign(std::acos(std::clamp(f, -1.0, 1.0)), random.uniform() - 0.5);
+	return {
+		static_cast<float>(axis[0] * std::cos(theta) - axis[1] * std::sin(theta)),
+		static_cast<float>(axis[0] * std::sin(theta) + axis[1] * std::cos(theta))
+	};
+}
+
+template<size_t N>
+OnLattice<N>::OnLattice(const size_t lattice_length, const double beta, const double j, const double h, const Update update, const size_t over_relaxations)
+	: lattice_length(lattice_length), beta(beta), j(j), h(h), update(update), over_relaxations(over_relaxations) {
+	assert(lattice_length % 2 == 0);
+	for (std::vector<float> & component : components) component.assign(num_sites(), 0.0f);
+	std::ranges::fill(components[0], 1.0f);
+
+	const auto index = [&] (const size_t row, const size_t col) {
+		return (row + col) % 2 * (num_sites() / 2) + (row * lattice_length + col) / 2;
+	};
+
+	neighbours.resize(4 * num_sites());
+	for (const size_t row : std::views::iota(static_cast<size_t>(0), lattice_length)) {
+		for (const size_t col : std::views::iota(static_cast<size_t>(0), lattice_length)) {
+			const size_t i = index(row, col);
+			neighbours[4 * i + 0] = static_cast<uint32_t>(index(row, (col + 1) % lattice_length));
+			neighbours[4 * i + 1] = static_cast<uint32_t>(index(row, (col + lattice_length - 1) % lattice_length));
+			neighbours[4 * i + 2] = static_cast<uint32_t>(index((row + 1) % lattice_length, col));
+			neighbours[4 * i + 3] = static_cast<uint32_t>(index((row + lattice_length - 1) % lattice_length, col));
+		}
+	}
+}
+
+template<size_t N>
+size_t OnLattice<N>::num_sites() const noexcept {
+	return lattice_length * lattice_length;
+}
+
+template<size_t N>
+double OnLattice<N>::energy() const {
+	double bonds = 0.0, field = 0.0;
+	for (const size_t i : std::views::iota(static_cast<size_t>(0), num_sites())) {
+		for (const size_t a : std::views::iota(static_cast<size_t>(0), N)) {
+			bonds += components[a][i] * (components[a][neighbours[4 * i + 0]] + components[a][neighbours[4 * i + 2]]);
+		}
+		field += components[0][i];
+	}
+	return -j * bonds - h * field;
+}
+
+template<size_t N>
+double OnLattice<N>::magnetization() const {
+	double squared = 0.0;
+	for (const std::vector<float> & component : components) {
+		squared += std::pow(std::ranges::fold_left(component, 0.0, std::plus()), 2);
+	}
+	return std::sqrt(squared);
+}
+
+template<size_t N>
+LatticeObservable OnLattice<N>::observable() const {
+	return { current_sweeps, j, energy(), magnetization() };
+}
+
+template<size_t N>
+std::array<float, N> OnLattice<N>::local_field(const size_t i) const {
+	std::array<float, N> field {};
+	for (const size_t a : std::views::iota(static_cast<size_t>(0), N)) {
+		field[a] = static_cast<float>(j) * (components[a][neighbours[4 * i]] + components[a][neighbours[4 * i + 1]] + components[a][neighbours[4 * i + 2]] + components[a][neighbours[4 * i + 3]]);
+	}
+	field[0] += static_cast<float>(h);
+	return field;
+}
+
+/**
+ * The uniform numbers of a chunk of sites are drawn up front, so the loop over the sites of a sublattice has neither
+ * calls into the random number generator nor dependencies between iterations and is vectorized. The proposed
+ * direction and the acceptance use the first N - 1 and the last number of every site. The sine of the azimuth is
+ * derived from its cosine, since a call of sincos would keep the loop from being vectorized.
+ */
+template<size_t N>
+void OnLattice<N>::metropolis_sweep() {
+	RandomBuffer & random = RandomBuffer::local();
+	const size_t half = num_sites() / 2;
+	const uint32_t * const neighbour = neighbours.data();
+	const auto coupling = static_cast<float>(j), field_strength = static_cast<float>(h), inverse_temperature = static_cast<float>(beta);
+	constexpr auto pi = std::numbers::pi_v<float>, two_pi = 2.0f * pi;
+
+	std::array<float *, N> spin;
+	for (const size_t a : std::views::iota(static_cast<size_t>(0), N)) spin[a] = components[a].data();
+
+	std::array<std::array<float, CHUNK_SIZE>, N> uniforms;
+	for (const size_t sublattice : { 0, 1 }) {
+		const size_t end = (sublattice + 1) * half;
+		for (size_t begin = sublattice * half; begin < end; begin += CHUNK_SIZE) {
+			const size_t count = std::min(CHUNK_SIZE, end - begin);
+			for (std::array<float, CHUNK_SIZE> & numbers : uniforms) {
+				for (size_t k = 0; k < count; ++k) numbers[k] = random.uniform_float();
+			}
+
+#pragma GCC ivdep
+			for (size_t k = 0; k < count; ++k) {
+				const size_t i = begin + k;
+				float field[N], proposal[N];
+				for (size_t a = 0; a < N; ++a) {
+					field[a] = coupling * (spin[a][neighbour[4 * i]] + spin[a][neighbour[4 * i + 1]] + spin[a][neighbour[4 * i + 2]] + spin[a][neighbour[4 * i + 3]]);
+				}
+				field[0] += field_strength;
+
+				const float phi = two_pi * uniforms[0][k], cos_phi = std::cos(phi);
+				const float sin_phi = std::copysign(std::sqrt(std::max(0.0f, 1.0f - cos_phi * cos_phi)), pi - phi);
+				if constexpr (N == 2) {
+					proposal[0] = cos_phi;
+					proposal[1] = sin_phi;
+				} else {
+					const float z = 2.0f * uniforms[1][k] - 1.0f, r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+					proposal[0] = r * cos_phi;
+					proposal[1] = r * sin_phi;
+					proposal[2] = z;
+				}
+
+				float diff_energy = 0.0f;
+				for (size_t a = 0; a < N; ++a) diff_energy -= (proposal[a] - spin[a][i]) * field[a];
+				const bool accepted = std::exp(-inverse_temperature * diff_energy) > uniforms[N - 1][k];
+				for (size_t a = 0; a < N; ++a) spin[a][i] = accepted ? proposal[a] : spin[a][i];
+			}
+		}
+	}
+}
+
+/**
+ * The cosine of the angle of a Heisenberg spin to the field follows an exponential distribution, which is inverted in
+ * closed form, and its azimuth around the field is uniform. Sites without a field are drawn uniformly on the sphere by
+ * selecting the z axis and the uniform cosine instead of branching, so the loop over a chunk vectorizes. As in the
+ * Metropolis sweep, the sine of the azimuth is derived from its cosine.
+ */
+template<size_t N>
+void OnLattice<N>::heat_bath_sweep() {
+	RandomBuffer & random = RandomBuffer::local();
+	if constexpr (N == 2) {
+		for (const size_t i : std::views::iota(static_cast<size_t>(0), num_sites())) {
+			const std::array<float, N> spin = sample_von_mises(local_field(i), beta, random);
+			for (const size_t a : std::views::iota(static_cast<size_t>(0), N)) components[a][i] = spin[a];
+		}
+	} else {
+		const size_t half = num_sites() / 2;
+		const uint32_t * const neighbour = neighbours.data();
+		float * const x = components[0].data(), * const y = components[1].data(), * const z = components[2].data();
+
+		std::array<std::array<double, CHUNK_SIZE>, 2> uniforms;
+		for (const size_t sublattice : { 0, 1 }) {
+			const size_t end = (sublattice + 1) * half;
+			for (size_t begin = sublattice * half; begin < end; begin += CHUNK_SIZE) {
+				const size_t count = std::min(CHUNK_SIZE, end - begin);
+				for (std::array<double, CHUNK_SIZE> & numbers : uniforms) {
+					for (size_t k = 0; k < count; ++k) numbers[k] = random.uniform();
+				}
+
+#pragma GCC ivdep
+				for (size_t k = 0; k < count; ++k) {
+					const size_t i = begin + k;
+					const uint32_t * const n = neighbour + 4 * i;
+					const double field_x = j * (x[n[0]] + x[n[1]] + x[n[2]] + x[n[3]]) + h;
+					const double field_y = j * (y[n[0]] + y[n[1]] + y[n[2]] + y[n[3]]);
+					const double field_z = j * (z[n[0]] + z[n[1]] + z[n[2]] + z[n[3]]);
+
+					const double norm = std::sqrt(field_x * field_x + field_y * field_y + field_z * field_z), kappa = beta * norm;
+					const bool free = kappa < 1e-6;
+					const double scale = free ? 0.0 : 1.0 / norm, safe_kappa = free ? 1.0 : kappa;
+					const double axis_x = field_x * scale, axis_y = field_y * scale, axis_z = free ? 1.0 : field_z * scale;
+
+					const double cos_theta = free ? 2.0 * uniforms[0][k] - 1.0
+						: 1.0 + std::log(1.0 - uniforms[0][k] * (1.0 - std::exp(-2.0 * safe_kappa))) / safe_kappa;
+					const double sin_theta = std::sqrt(std::max(0.0, 1.0 - cos_theta * cos_theta));
+					const double phi = 2.0 * std::numbers::pi * uniforms[1][k];
+
+					// The cross product of the axis with the x or y unit vector, whichever is less parallel to the axis.
+					const bool x_helper = std::abs(axis_x) < 0.9;
+					double u_x = x_helper ? 0.0 : -axis_z, u_y = x_helper ? axis_z : 0.0, u_z = x_helper ? -axis_y : axis_x;
+					const double u_scale = 1.0 / std::sqrt(u_x * u_x + u_y * u_y + u_z * u_z);
+					u_x *= u_scale;
+					u_y *= u_scale;
+					u_z *= u_scale;
+					const double v_x = axis_y * u_z - axis_z * u_y, v_y = axis_z * u_x - axis_x * u_z, v_z = axis_x * u_y - axis_y * u_x;
+
+					const double cos_phi = std::cos(phi), sin_phi = std::copysign(std::sqrt(std::max(0.0, 1.0 - cos_phi * cos_phi)), std::numbers::pi - phi);
+					x[i] = static_cast<float>(cos_theta * axis_x + sin_theta * (cos_phi * u_x + sin_phi * v_x));
+					y[i] = static_cast<float>(cos_theta * axis_y + sin_theta * (cos_phi * u_y + sin_phi * v_y));
+					z[i] = static_cast<float>(cos_theta * axis_z + sin_theta * (cos_phi * u_z + sin_phi * v_z));
+				}
+			}
+		}
+	}
+}
+
+/**
+ * The sites of one sublattice only have neighbours on the other sublattice, so the loop over a sublattice has no
+ * dependencies between iterations and is vectorized.
+ */
+template<size_t N>
+void OnLattice<N>::over_relaxation_sweep() {
+	const size_t half = num_sites() / 2;
+	const uint32_t * const neighbour = neighbours.data();
+	const auto coupling = static_cast<float>(j), field_strength = static_cast<float>(h);
+
+	std::array<float *, N> spin;
+	for (const size_t a : std::views::iota(static_cast<size_t>(0), N)) spin[a] = components[a].data();
+
+	for (const size_t sublattice : { 0, 1 }) {
+#pragma GCC ivdep
+		for (size_t i = sublattice * half; i < (sublattice + 1) * half; ++i) {
+			float field[N], projection = 0.0f, norm = 0.0f;
+			for (size_t a = 0; a < N; ++a) {
+				field[a] = coupling * (spin[a][neighbour[4 * i]] + spin[a][neighbour[4 * i + 1]] + spin[a][neighbour[4 * i + 2]] + spin[a][neighbour[4 * i + 3]]);
+			}
+			field[0] += field_strength;
+
+			for (size_t a = 0; a < N; ++a) {
+				projection += spin[a][i] * field[a];
+				norm += field[a] * field[a];
+			}
+
+			const float scale = norm > 0.0f ? 2.0f * projection / norm : 0.0f;
+			for (size_t a = 0; a < N; ++a) {
+				spin[a][i] = norm > 0.0f ? scale * field[a] - spin[a][i] : spin[a][i];
+			}
+		}
+	}
+}
+
+template<size_t N>
+void OnLattice<N>::sweep() {
+	current_sweeps += 1;
+	if (update == Update::Metropolis) {
+		metropolis_sweep();
+	} else {
+		heat_bath_sweep();
+	}
+	for (size_t i = 0; i < over_relaxations; ++i) over_relaxation_sweep();
+}
+
+template class OnLattice<2>;
+template class OnLattice<3>;
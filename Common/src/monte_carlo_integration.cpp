@@ -0,0 +1,140 @@
+#include "monte_carlo_integration.h"
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_reduce.h>
+
+#include "random_buffer.h"
+
+/**
+ * The number of bits of the Sobol direction numbers.
+ */
+constexpr size_t SOBOL_BITS = 32;
+
+/**
+ * The number of batches per task, every task draws from its own stream of the seed.
+ */
+constexpr size_t BATCHES_PER_TASK = 64;
+
+/**
+ * Returns the direction numbers of the second Sobol dimension with primitive polynomial x + 1, the first dimension
+ * is the van der Corput sequence with direction numbers 2^(31 - k).
+ */
+static constexpr std::array<uint32_t, SOBOL_BITS> sobol_directions() {
+	std::array<uint32_t, SOBOL_BITS> directions {};
+	uint32_t m = 1;
+	for (size_t k = 0; k < SOBOL_BITS; ++k) {
+		directions[k] = m << (SOBOL_BITS - 1 - k);
+		m ^= m << 1;
+	}
+	return directions;
+}
+
+static constexpr std::array<uint32_t, SOBOL_BITS> SOBOL_DIRECTIONS = sobol_directions();
+
+/**
+ * Reflects the digits of the index in the given base at the decimal point.
+ */
+static double radical_inverse(uint64_t index, const uint64_t base) {
+	const double inverse_base = 1.0 / static_cast<double>(base);
+	double result = 0.0, factor = inverse_base;
+	while (index > 0) {
+		result += static_cast<double>(index % base) * factor;
+		index /= base;
+		factor *= inverse_base;
+	}
+	return result;
+}
+
+MonteCarloIntegrator::MonteCarloIntegrator(const SampleSequence sequence, const uint64_t seed) : sequence(sequence), seed(seed) {
+}
+
+/**
+ * The Sobol points are generated in Gray code order, which only needs a single XOR per point once the first point
+ * of the batch has been computed from the binary digits of its index.
+ */
+void MonteCarloIntegrator::generate(const uint64_t first, const std::span<double> x, const std::span<double> y, RandomBuffer & random) const {
+	assert(x.size() == y.size());
+	switch (sequence) {
+		case SampleSequence::Pseudo:
+			for (size_t i = 0; i < x.size(); ++i) {
+				x[i] = random.uniform();
+				y[i] = random.uniform();
+			}
+			break;
+
+		case SampleSequence::Halton:
+			for (size_t i = 0; i < x.size(); ++i) {
+				x[i] = radical_inverse(first + i, 2);
+				y[i] = radical_inverse(first + i, 3);
+			}
+			break;
+
+		case SampleSequence::Sobol: {
+			constexpr double scale = 1.0 / 4294967296.0;
+			const uint64_t gray = first ^ (first >> 1);
+
+			uint32_t u = 0, v = 0;
+			for (size_t k = 0; k < SOBOL_BITS; ++k) {
+				if ((gray >> k) & 1) {
+					u ^= 1u << (SOBOL_BITS - 1 - k);
+					v ^= SOBOL_DIRECTIONS[k];
+				}
+			}
+			for (size_t i = 0; i < x.size(); ++i) {
+				x[i] = u * scale;
+				y[i] = v * scale;
+
+				const auto k = static_cast<size_t>(std::countr_zero(first + i + 1));
+				u ^= 1u << (SOBOL_BITS - 1 - k);
+				v ^= SOBOL_DIRECTIONS[k];
+			}
+			break;
+		}
+	}
+}
+
+IntegrationEstimate MonteCarloIntegrator::integrate(const Integrand & integrand, const size_t num_samples) const {
+	assert(num_samples > 0);
+	const size_t num_batches = (num_samples + BATCH_SIZE - 1) / BATCH_SIZE;
+	const size_t num_tasks = (num_batches + BATCHES_PER_TASK - 1) / BATCHES_PER_TASK;
+
+	const auto [sum, sum_squares] = tbb::parallel_reduce(tbb::blocked_range<size_t>(0, num_tasks), std::pair { 0.0, 0.0 }, [&] (const tbb::blocked_range<size_t> & range, std::pair<double, double> partial) {
+		std::vector<double> x (BATCH_SIZE), y (BATCH_SIZE);
+		for (size_t task = range.begin(); task != range.end(); ++task) {
+			RandomBuffer random { seed, task };
+
+			for (size_t batch = task * BATCHES_PER_TASK; batch < std::min(num_batches, (task + 1) * BATCHES_PER_TASK); ++batch) {
+				generate(batch * BATCH_SIZE, x, y, random);
+
+				const double mean = integrand(x, y) / BATCH_SIZE;
+				partial.first += mean;
+				partial.second += mean * mean;
+			}
+		}
+		return partial;
+	}, [] (const std::pair<double, double> lhs, const std::pair<double, double> rhs) {
+		return std::pair { lhs.first + rhs.first, lhs.second + rhs.second };
+	});
+
+	const auto n = static_cast<double>(num_batches);
+	const double mean = sum / n;
+	const double variance = num_batches > 1 ? std::max(0.0, sum_squares / n - mean * mean) * n / (n - 1.0) : 0.0;
+	return { num_batches * BATCH_SIZE, mean, std::sqrt(variance / n) };
+}
+
+double MonteCarloIntegrator::quarter_circle(const std::span<const double> x, const std::span<const double> y) {
+	assert(x.size() == y.size());
+	const double * const px = x.data(), * const py = y.data();
+
+	size_t hits = 0;
+	for (size_t i = 0; i < x.size(); ++i) {
+		hits += px[i] * px[i] + py[i] * py[i] <= 1.0;
+	}
+	return static_cast<double>(hits);
+}
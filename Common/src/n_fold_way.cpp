@@ -0,0 +1,119 @@
+#include "n_fold_way.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "random_buffer.h"
+
+/**
+ * The classes 0 ... 4 hold the down spins and 5 ... 9 the up spins, ordered by the bond sum difference -8 ... +8.
+ */
+NFoldWay::NFoldWay(Lattice2D & lattice) : lattice(lattice), classes(lattice.configuration().size()), positions(lattice.configuration().size()) {
+	for (size_t i = 0; i < classes.size(); ++i) {
+		classes[i] = classify(i);
+		positions[i] = static_cast<uint32_t>(members[classes[i]].size());
+		members[classes[i]].push_back(static_cast<uint32_t>(i));
+	}
+}
+
+double NFoldWay::time() const noexcept {
+	return current_time;
+}
+
+size_t NFoldWay::flips() const noexcept {
+	return num_flips;
+}
+
+double NFoldWay::total_rate() const noexcept {
+	return total_rate(class_rates());
+}
+
+std::array<double, NFoldWay::NUM_CLASSES> NFoldWay::class_rates() const {
+	std::array<double, NUM_CLASSES> rates;
+	for (const int spin : { -1, 1 }) {
+		for (const int diff_bonds : { -8, -4, 0, 4, 8 }) {
+			rates[(spin > 0) * 5 + (diff_bonds + 8) / 4] = lattice.acceptance(diff_bonds, -2 * spin);
+		}
+	}
+	return rates;
+}
+
+double NFoldWay::total_rate(const std::array<double, NUM_CLASSES> & rates) const noexcept {
+	double total = 0.0;
+	for (size_t c = 0; c < NUM_CLASSES; ++c) total += rates[c] * static_cast<double>(members[c].size());
+	return total;
+}
+
+LatticeObservable NFoldWay::observable() const {
+	LatticeObservable observable = lattice.observable();
+	observable.sweeps = static_cast<size_t>(current_time);
+	return observable;
+}
+
+uint8_t NFoldWay::classify(const size_t i) const {
+	return static_cast<uint8_t>((lattice.spin_sum_diff(i) < 0) * 5 + (lattice.bond_sum_diff(i) + 8) / 4);
+}
+
+void NFoldWay::move(const size_t i, const uint8_t target) {
+	std::vector<uint32_t> & source = members[classes[i]];
+	positions[source.back()] = positions[i];
+	source[positions[i]] = source.back();
+	source.pop_back();
+
+	classes[i] = target;
+	positions[i] = static_cast<uint32_t>(members[target].size());
+	members[target].push_back(static_cast<uint32_t>(i));
+}
+
+void NFoldWay::flip(const size_t i) {
+	lattice.flip(i);
+	num_flips += 1;
+
+	const size_t length = lattice.length(), row = i / length, col = i % length;
+	for (const size_t k : { i, row * length + (col + 1) % length, row * length + (col + length - 1) % length,
+			(row + 1) % length * length + col, (row + length - 1) % length * length + col }) {
+		if (const uint8_t target = classify(k); target != classes[k]) move(k, target);
+	}
+}
+
+/**
+ * A single uniform number selects both the class, by the cumulative class rates, and the site within the class, by
+ * the remainder.
+ */
+void NFoldWay::advance(const double duration) {
+	RandomBuffer & random = RandomBuffer::local();
+	const std::array<double, NUM_CLASSES> rates = class_rates();
+	const double target = current_time + duration;
+	while (true) {
+		const double total = total_rate(rates);
+		if (total <= 0.0) break;
+
+		const double waiting = -std::log1p(-random.uniform()) / total;
+		if (current_time + waiting > target) break;
+		current_time += waiting;
+
+		double remainder = random.uniform() * total;
+		size_t chosen = NUM_CLASSES;
+		for (size_t c = 0; c < NUM_CLASSES; ++c) {
+			const double rate = rates[c] * static_cast<double>(members[c].size());
+			if (rate <= 0.0) continue;
+			chosen = c;
+			if (remainder < rate) break;
+			remainder -= rate;
+		}
+
+		assert(chosen < NUM_CLASSES);
+		const std::vector<uint32_t> & candidates = members[chosen];
+		flip(candidates[std::min(static_cast<size_t>(remainder / rates[chosen]), candidates.size() - 1)]);
+	}
+	current_time = target;
+}
+
+void NFoldWay::sweep() {
+	advance(1.0);
+}
+
+size_t NFoldWay::num_sites() const noexcept {
+	return classes.size();
+}
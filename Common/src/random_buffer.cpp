@@ -0,0 +1,61 @@
+#include "random_buffer.h"
+
+#include <cmath>
+#include <random>
+
+/**
+ * The SplitMix64 generator which expands the seed into the states of the generators, as recommended for xoshiro.
+ */
+static uint64_t split_mix(uint64_t & state) {
+	uint64_t value = (state += 0x9E3779B97F4A7C15);
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EB;
+	return value ^ (value >> 31);
+}
+
+RandomBuffer::RandomBuffer(const uint64_t seed, const uint64_t stream) {
+	this->seed(seed, stream);
+}
+
+RandomBuffer & RandomBuffer::local() {
+	static thread_local RandomBuffer buffer { (static_cast<uint64_t>(std::random_device()()) << 32) | std::random_device()() };
+	return buffer;
+}
+
+uint64_t RandomBuffer::threshold(const double probability) noexcept {
+	if (!(probability > 0.0)) return 0;
+	if (probability >= 1.0) return std::numeric_limits<uint64_t>::max();
+	return static_cast<uint64_t>(std::ldexp(probability, 64));
+}
+
+void RandomBuffer::seed(const uint64_t seed, const uint64_t stream) {
+	uint64_t stream_state = stream;
+	uint64_t mixer = seed ^ split_mix(stream_state);
+	for (std::array<uint64_t, LANES> & words : state) {
+		for (uint64_t & word : words) word = split_mix(mixer);
+	}
+	position = BLOCK_SIZE;
+}
+
+/**
+ * The rotations are written as pairs of shifts and the multiplications by 5 and 9 reduce to shifts and additions, so
+ * the loop over the lanes vectorizes without 64-bit vector multiplications.
+ */
+void RandomBuffer::refill() noexcept {
+	auto & [s0, s1, s2, s3] = state;
+	for (size_t offset = 0; offset < BLOCK_SIZE; offset += LANES) {
+		for (size_t lane = 0; lane < LANES; ++lane) {
+			const uint64_t scaled = s1[lane] * 5;
+			buffer[offset + lane] = ((scaled << 7) | (scaled >> 57)) * 9;
+
+			const uint64_t shifted = s1[lane] << 17;
+			s2[lane] ^= s0[lane];
+			s3[lane] ^= s1[lane];
+			s1[lane] ^= s2[lane];
+			s0[lane] ^= s3[lane];
+			s2[lane] ^= shifted;
+			s3[lane] = (s3[lane] << 45) | (s3[lane] >> 19);
+		}
+	}
+	position = 0;
+}
@@ -0,0 +1,234 @@
+#include "result_cache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <filesystem>
+#include <stdexcept>
+
+#include "trace.h"
+
+#ifndef COMMON_SOURCE_HASH
+#define COMMON_SOURCE_HASH "unknown"
+#endif
+
+/**
+ * Identifies the layout of the cache file, [magic] followed by [hash][spec length][spec][count][count doubles] entries.
+ */
+static constexpr uint64_t CACHE_MAGIC = 0x3243484341434D49; // "IMCACHC2"
+
+template <typename T>
+static bool read_value(std::istream & input, T & value) {
+	return static_cast<bool>(input.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+template <typename T>
+static void write_value(std::ostream & output, const T & value) {
+	output.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+/**
+ * Copies the given number of bytes between the streams in chunks, so no entry has to fit into memory at once.
+ */
+static bool copy_bytes(std::istream & input, std::ostream & output, uint64_t bytes) {
+	std::vector<char> chunk (1 << 20);
+	while (bytes > 0) {
+		const auto size = static_cast<std::streamsize>(std::min<uint64_t>(bytes, chunk.size()));
+		if (!input.read(chunk.data(), size)) return false;
+		output.write(chunk.data(), size);
+		bytes -= static_cast<uint64_t>(size);
+	}
+	return true;
+}
+
+/**
+ * The file is scanned by seeking over the values, so opening a large cache only costs the reads of the headers.
+ */
+ResultCache::ResultCache(const std::string & name, const std::string & version)
+	: version(version + "+" COMMON_SOURCE_HASH), path("output/cache/" + name + ".bin") {
+	std::filesystem::create_directories("output/cache");
+	const std::string prefix = "version=" + this->version + ";";
+
+	size_t stale = 0;
+	std::ifstream input (path, std::ios::binary);
+	if (uint64_t magic; input && read_value(input, magic)) {
+		if (magic != CACHE_MAGIC) stale += 1;
+
+		const uint64_t size = std::filesystem::file_size(path);
+		uint64_t hash, length, count;
+		while (magic == CACHE_MAGIC && read_value(input, hash) && read_value(input, length)) {
+			const auto position = static_cast<uint64_t>(input.tellg());
+			Location location { std::string(), 0, 0 };
+			if (length > size - position) {
+				stale += 1;
+				break;
+			}
+			location.spec.resize(length);
+			if (!input.read(location.spec.data(), static_cast<std::streamsize>(length)) || !read_value(input, count)) {
+				stale += 1;
+				break;
+			}
+			location.offset = static_cast<uint64_t>(input.tellg());
+			location.count = count;
+			if (count > (size - location.offset) / sizeof(double)) {
+				stale += 1;
+				break;
+			}
+			input.seekg(static_cast<std::streamoff>(count * sizeof(double)), std::ios::cur);
+
+			if (!location.spec.starts_with(prefix)) stale += 1;
+			else if (!index.insert_or_assign(hash, std::move(location)).second) stale += 1;
+		}
+	}
+
+	if (stale > 0 || !std::filesystem::exists(path)) {
+		const std::string compacted = path + ".tmp";
+		{
+			std::ofstream output (compacted, std::ios::binary | std::ios::trunc);
+			write_value(output, CACHE_MAGIC);
+			uint64_t offset = sizeof(CACHE_MAGIC);
+			input.clear();
+			for (auto & [hash, location] : index) {
+				offset += write_header(output, hash, location.spec, location.count);
+				input.seekg(static_cast<std::streamoff>(location.offset));
+				copy_bytes(input, output, location.count * sizeof(double));
+				location.offset = offset;
+				offset += location.count * sizeof(double);
+			}
+		}
+		input.close();
+		std::filesystem::rename(compacted, path);
+	}
+	input.close();
+
+	// Removes the spill files of streamed computations which were interrupted.
+	for (const std::filesystem::directory_entry & entry : std::filesystem::directory_iterator("output/cache")) {
+		const std::string spilled = entry.path().string();
+		if (spilled.starts_with(path + ".") && spilled.ends_with(".spill")) std::filesystem::remove(entry.path());
+	}
+
+	end = std::filesystem::file_size(path);
+	file.open(path, std::ios::binary | std::ios::app);
+}
+
+uint64_t ResultCache::write_header(std::ostream & output, const uint64_t hash, const std::string & spec, const uint64_t count) {
+	write_value(output, hash);
+	write_value(output, static_cast<uint64_t>(spec.size()));
+	output.write(spec.data(), static_cast<std::streamsize>(spec.size()));
+	write_value(output, count);
+	return 3 * sizeof(uint64_t) + spec.size();
+}
+
+std::vector<double> ResultCache::read(const Location & location) const {
+	std::ifstream input (path, std::ios::binary);
+	std::vector<double> values (location.count);
+	input.seekg(static_cast<std::streamoff>(location.offset));
+	if (!input.read(reinterpret_cast<char *>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(double)))) {
+		throw std::runtime_error("Cannot read cached result from " + path);
+	}
+	return values;
+}
+
+void ResultCache::read(const Location & location, const ValueSink & sink, const size_t block_values) const {
+	assert(block_values > 0);
+	std::ifstream input (path, std::ios::binary);
+	input.seekg(static_cast<std::streamoff>(location.offset));
+
+	std::vector<double> block;
+	for (uint64_t remaining = location.count; remaining > 0; remaining -= block.size()) {
+		block.resize(std::min<uint64_t>(remaining, block_values));
+		if (!input.read(reinterpret_cast<char *>(block.data()), static_cast<std::streamsize>(block.size() * sizeof(double)))) {
+			throw std::runtime_error("Cannot read cached result from " + path);
+		}
+		sink(block);
+	}
+}
+
+/**
+ * The values of an indexed entry are complete and flushed, since the index is only updated after the entry has been
+ * written, so they are read without holding the lock.
+ */
+std::vector<double> ResultCache::fetch(const RunSpec & spec, const std::function<std::vector<double>()> & compute) {
+	const TraceSpan span { "cache_fetch", { { "lattice_length", spec.lattice_length }, { "j", spec.j }, { "h", spec.h } } };
+	const uint64_t hash = spec.hash(version);
+	std::string serialized = spec.serialize(version);
+	{
+		std::unique_lock index_lock (index_mtx);
+		if (const auto entry = index.find(hash); entry != index.end() && entry->second.spec == serialized) {
+			const Location location = entry->second;
+			index_lock.unlock();
+			return read(location);
+		}
+	}
+
+	std::vector<double> values = [&] {
+		const TraceSpan compute_span { "cache_compute" };
+		return compute();
+	}();
+
+	std::lock_guard index_lock (index_mtx);
+	const uint64_t offset = end + write_header(file, hash, serialized, values.size());
+	file.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(double)));
+	file.flush();
+	end = offset + values.size() * sizeof(double);
+	index.insert_or_assign(hash, Location { std::move(serialized), offset, values.size() });
+	return values;
+}
+
+void ResultCache::stream(const RunSpec & spec, const std::function<void(const ValueSink &)> & compute, const ValueSink & sink, const size_t block_values) {
+	const TraceSpan span { "cache_stream", { { "lattice_length", spec.lattice_length }, { "j", spec.j }, { "h", spec.h } } };
+	const uint64_t hash = spec.hash(version);
+	std::string serialized = spec.serialize(version);
+	{
+		std::unique_lock index_lock (index_mtx);
+		if (const auto entry = index.find(hash); entry != index.end() && entry->second.spec == serialized) {
+			const Location location = entry->second;
+			index_lock.unlock();
+			read(location, sink, block_values);
+			return;
+		}
+	}
+
+	const std::string spill_path = path + "." + std::to_string(spills.fetch_add(1)) + ".spill";
+	uint64_t count = 0;
+	{
+		const TraceSpan compute_span { "cache_compute" };
+		std::ofstream spill (spill_path, std::ios::binary | std::ios::trunc);
+		compute([&] (const std::span<const double> values) {
+			spill.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(double)));
+			count += values.size();
+		});
+	}
+
+	if (std::filesystem::file_size(spill_path) != count * sizeof(double)) {
+		throw std::runtime_error("Cannot write spilled result to " + spill_path);
+	}
+
+	{
+		std::ifstream spilled (spill_path, std::ios::binary);
+		std::lock_guard index_lock (index_mtx);
+		const uint64_t offset = end + write_header(file, hash, serialized, count);
+		copy_bytes(spilled, file, count * sizeof(double));
+		file.flush();
+		end = offset + count * sizeof(double);
+		index.insert_or_assign(hash, Location { std::move(serialized), offset, count });
+	}
+	std::filesystem::remove(spill_path);
+}
+
+std::vector<double> serialize_history(const std::span<const LatticeObservable> history) {
+	std::vector<double> values;
+	values.reserve(3 * history.size());
+	for (const LatticeObservable & observable : history) {
+		values.insert(values.end(), { static_cast<double>(observable.sweeps), observable.energy, observable.magnetization });
+	}
+	return values;
+}
+
+std::vector<LatticeObservable> deserialize_history(const std::span<const double> values, const double j) {
+	std::vector<LatticeObservable> history;
+	history.reserve(values.size() / 3);
+	for (size_t i = 0; i + 2 < values.size(); i += 3) {
+		history.emplace_back(static_cast<size_t>(values[i]), j, values[i + 1], values[i + 2]);
+	}
+	return history;
+}
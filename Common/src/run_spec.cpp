@@ -0,0 +1,55 @@
+#include "run_spec.h"
+
+#include <bit>
+#include <format>
+
+/**
+ * The offset basis and prime of the 64-bit FNV-1a hash.
+ */
+static constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+static constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+/**
+ * Folds the given bytes into the hash.
+ */
+static uint64_t fnv1a(uint64_t hash, const std::string_view bytes) {
+	for (const char byte : bytes) {
+		hash = (hash ^ static_cast<uint8_t>(byte)) * FNV_PRIME;
+	}
+	return hash;
+}
+
+/**
+ * Folds the eight bytes of the given value into the hash.
+ */
+static uint64_t fnv1a(uint64_t hash, const uint64_t value) {
+	for (size_t shift = 0; shift < 64; shift += 8) {
+		hash = (hash ^ ((value >> shift) & 0xFF)) * FNV_PRIME;
+	}
+	return hash;
+}
+
+/**
+ * Strings are followed by their length so that the contents of adjacent fields cannot alias.
+ */
+uint64_t RunSpec::hash(const std::string_view version) const {
+	uint64_t hash = FNV_OFFSET;
+	hash = fnv1a(fnv1a(hash, version), version.size());
+	hash = fnv1a(fnv1a(hash, lattice), lattice.size());
+	hash = fnv1a(hash, lattice_length);
+	hash = fnv1a(hash, std::bit_cast<uint64_t>(beta));
+	hash = fnv1a(hash, std::bit_cast<uint64_t>(j));
+	hash = fnv1a(hash, std::bit_cast<uint64_t>(h));
+	hash = fnv1a(hash, sweeps);
+	hash = fnv1a(hash, experiments);
+	hash = fnv1a(hash, seed);
+	return fnv1a(fnv1a(hash, algorithm), algorithm.size());
+}
+
+/**
+ * The doubles are formatted with the shortest representation which reads back to the same value.
+ */
+std::string RunSpec::serialize(const std::string_view version) const {
+	return std::format("version={};lattice={};lattice_length={};beta={};j={};h={};sweeps={};experiments={};seed={};algorithm={}",
+		version, lattice, lattice_length, beta, j, h, sweeps, experiments, seed, algorithm);
+}
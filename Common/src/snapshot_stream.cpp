@@ -0,0 +1,323 @@
+#include "snapshot_stream.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+/**
+ * Identifies snapshot files in the header and trailer.
+ */
+constexpr uint64_t SNAPSHOT_MAGIC = 0x31504e5347495349;
+
+/**
+ * The top bit of a word run token marks literal words, the remaining bits hold the number of words.
+ */
+constexpr uint64_t LITERAL_FLAG = static_cast<uint64_t>(1) << 63;
+
+static void append_word(std::vector<uint8_t> & encoded, const uint64_t word) {
+	const size_t size = encoded.size();
+	encoded.resize(size + sizeof(word));
+	std::memcpy(encoded.data() + size, &word, sizeof(word));
+}
+
+static uint64_t read_word(const std::byte * data) {
+	uint64_t word;
+	std::memcpy(&word, data, sizeof(word));
+	return word;
+}
+
+/**
+ * Appends tokens for the words. A run of at least two equal words is stored as a token and the word, the words
+ * between runs are stored as a token followed by the literal words.
+ */
+static void encode_word_runs(const std::span<const uint64_t> words, std::vector<uint8_t> & encoded) {
+	size_t i = 0;
+	while (i < words.size()) {
+		size_t run = 1;
+		while (i + run < words.size() && words[i + run] == words[i]) ++run;
+
+		if (run > 1) {
+			append_word(encoded, run);
+			append_word(encoded, words[i]);
+			i += run;
+			continue;
+		}
+
+		size_t literal = 1;
+		while (i + literal < words.size() && !(i + literal + 1 < words.size() && words[i + literal] == words[i + literal + 1])) ++literal;
+		append_word(encoded, LITERAL_FLAG | literal);
+		for (size_t k = 0; k < literal; ++k) append_word(encoded, words[i + k]);
+		i += literal;
+	}
+}
+
+/**
+ * Appends the lengths of the runs of zero bits before every set bit as LEB128 variable-length integers, so a sparse
+ * delta frame costs about one byte per flipped spin.
+ */
+static void encode_bit_runs(const std::span<const uint64_t> words, std::vector<uint8_t> & encoded) {
+	uint64_t next = 0;
+	for (size_t w = 0; w < words.size(); ++w) {
+		for (uint64_t word = words[w]; word != 0; word &= word - 1) {
+			const uint64_t position = 64 * w + static_cast<uint64_t>(std::countr_zero(word));
+			uint64_t run = position - next;
+			next = position + 1;
+
+			do {
+				encoded.push_back(static_cast<uint8_t>((run & 0x7f) | (run >= 0x80 ? 0x80 : 0)));
+				run >>= 7;
+			} while (run > 0);
+		}
+	}
+}
+
+SnapshotWriter::SnapshotWriter(const std::string & file_name, const size_t num_sites, const SnapshotOptions options)
+	: num_sites(num_sites), options(options), previous((num_sites + 63) / 64), current((num_sites + 63) / 64) {
+	assert(options.keyframe_interval > 0);
+	output.open("output/" + file_name + ".snap", std::ios::binary);
+
+	const uint64_t header[] { SNAPSHOT_MAGIC, num_sites };
+	output.write(reinterpret_cast<const char *>(header), sizeof(header));
+	offset = sizeof(header);
+}
+
+SnapshotWriter::~SnapshotWriter() {
+	close();
+}
+
+void SnapshotWriter::write(const size_t sweeps, const std::span<const int8_t> spins) {
+	assert(spins.size() == num_sites && output.is_open());
+	const TraceSpan span { "snapshot_write", { { "sweeps", sweeps } } };
+
+	std::ranges::fill(current, 0);
+	for (size_t i = 0; i < num_sites; ++i) {
+		current[i / 64] |= static_cast<uint64_t>(spins[i] > 0) << (i % 64);
+	}
+
+	const bool keyframe = !options.delta || index.size() % options.keyframe_interval == 0;
+	delta = current;
+	if (!keyframe) {
+		for (size_t w = 0; w < delta.size(); ++w) delta[w] ^= previous[w];
+	}
+	std::swap(previous, current);
+
+	SnapshotEncoding encoding = SnapshotEncoding::Raw;
+	encoded.clear();
+	for (const uint64_t word : delta) append_word(encoded, word);
+
+	if (options.run_length) {
+		candidate.clear();
+		encode_word_runs(delta, candidate);
+		if (candidate.size() < encoded.size()) {
+			std::swap(encoded, candidate);
+			encoding = SnapshotEncoding::WordRuns;
+		}
+
+		candidate.clear();
+		encode_bit_runs(delta, candidate);
+		if (candidate.size() < encoded.size()) {
+			std::swap(encoded, candidate);
+			encoding = SnapshotEncoding::BitRuns;
+		}
+	}
+
+	const SnapshotFrameHeader header { sweeps, encoded.size(), keyframe, encoding };
+	output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	output.write(reinterpret_cast<const char *>(encoded.data()), static_cast<std::streamsize>(encoded.size()));
+	index.push_back({ sweeps, offset + sizeof(header), encoded.size(), keyframe, encoding });
+	if (keyframe) output.flush();
+
+	offset += sizeof(header) + encoded.size();
+	total_frame_bytes += encoded.size();
+}
+
+/**
+ * The index is followed by a trailer of the number of frames, the offset of the index and the magic number, so the
+ * reader finds the index from the end of the file.
+ */
+void SnapshotWriter::close() {
+	if (!output.is_open()) return;
+	output.write(reinterpret_cast<const char *>(index.data()), static_cast<std::streamsize>(index.size() * sizeof(SnapshotIndexEntry)));
+
+	const uint64_t trailer[] { index.size(), offset, SNAPSHOT_MAGIC };
+	output.write(reinterpret_cast<const char *>(trailer), sizeof(trailer));
+	output.close();
+}
+
+size_t SnapshotWriter::frame_bytes() const noexcept {
+	return total_frame_bytes;
+}
+
+size_t SnapshotWriter::size() const noexcept {
+	return index.size();
+}
+
+SnapshotReader::SnapshotReader(const std::string & file_name) {
+	const std::string path = "output/" + file_name + ".snap";
+	const int descriptor = ::open(path.c_str(), O_RDONLY);
+	if (descriptor < 0) {
+		throw std::runtime_error("Cannot open snapshot file " + path);
+	}
+
+	struct stat status {};
+	::fstat(descriptor, &status);
+	length = static_cast<size_t>(status.st_size);
+
+	void * mapping = length > 0 ? ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0) : MAP_FAILED;
+	::close(descriptor);
+	if (mapping == MAP_FAILED) {
+		throw std::runtime_error("Cannot map snapshot file " + path);
+	}
+	data = static_cast<const std::byte *>(mapping);
+
+	uint64_t header[2], trailer[3];
+	if (length < sizeof(header)) {
+		throw std::runtime_error("Truncated snapshot file " + path);
+	}
+	std::memcpy(header, data, sizeof(header));
+	if (header[0] != SNAPSHOT_MAGIC) {
+		throw std::runtime_error("Corrupt snapshot file " + path);
+	}
+	sites = header[1];
+
+	if (length >= sizeof(header) + sizeof(trailer)) {
+		std::memcpy(trailer, data + length - sizeof(trailer), sizeof(trailer));
+		const size_t index_bytes = length - sizeof(trailer) - trailer[1];
+		if (trailer[2] == SNAPSHOT_MAGIC && trailer[1] >= sizeof(header) && trailer[1] <= length - sizeof(trailer)
+				&& index_bytes / sizeof(SnapshotIndexEntry) == trailer[0] && index_bytes % sizeof(SnapshotIndexEntry) == 0) {
+			index.resize(trailer[0]);
+			std::memcpy(index.data(), data + trailer[1], index_bytes);
+			return;
+		}
+	}
+	rebuild_index(length);
+}
+
+/**
+ * Stops at the first header which is incomplete, invalid or followed by an incomplete payload, which is where the
+ * writer was interrupted.
+ */
+void SnapshotReader::rebuild_index(const size_t end) {
+	index.clear();
+	size_t offset = 2 * sizeof(uint64_t);
+	while (end - offset >= sizeof(SnapshotFrameHeader)) {
+		SnapshotFrameHeader header {};
+		std::memcpy(&header, data + offset, sizeof(header));
+		offset += sizeof(header);
+
+		if (header.keyframe > 1 || header.encoding > SnapshotEncoding::BitRuns || header.bytes > end - offset) break;
+		if (index.empty() && !header.keyframe) break;
+		index.push_back({ header.sweeps, offset, header.bytes, header.keyframe, header.encoding });
+		offset += header.bytes;
+	}
+}
+
+SnapshotReader::~SnapshotReader() {
+	if (data != nullptr) ::munmap(const_cast<std::byte *>(data), length);
+}
+
+size_t SnapshotReader::size() const noexcept {
+	return index.size();
+}
+
+size_t SnapshotReader::num_sites() const noexcept {
+	return sites;
+}
+
+size_t SnapshotReader::sweeps(const size_t frame) const {
+	return index.at(frame).sweeps;
+}
+
+void SnapshotReader::decode(const SnapshotIndexEntry & entry, const std::span<uint64_t> words) const {
+	if (entry.offset > length || entry.bytes > length - entry.offset) {
+		throw std::runtime_error("Snapshot frame exceeds the file");
+	}
+	const std::byte * const begin = data + entry.offset, * const end = begin + entry.bytes;
+	const auto remaining_words = [&] (const std::byte * position) { return static_cast<size_t>(end - position) / sizeof(uint64_t); };
+	if (entry.keyframe) std::ranges::fill(words, 0);
+
+	switch (entry.encoding) {
+		case SnapshotEncoding::Raw:
+			if (entry.bytes != words.size() * sizeof(uint64_t)) {
+				throw std::runtime_error("Corrupt raw snapshot frame");
+			}
+			for (size_t w = 0; w < words.size(); ++w) words[w] ^= read_word(begin + w * sizeof(uint64_t));
+			break;
+
+		case SnapshotEncoding::WordRuns: {
+			size_t w = 0;
+			for (const std::byte * token = begin; token < end; ) {
+				if (remaining_words(token) < 1) {
+					throw std::runtime_error("Corrupt word run snapshot frame");
+				}
+				const uint64_t header = read_word(token), count = header & ~LITERAL_FLAG;
+				token += sizeof(uint64_t);
+				if (count > words.size() - w || remaining_words(token) < (header & LITERAL_FLAG ? count : 1)) {
+					throw std::runtime_error("Corrupt word run snapshot frame");
+				}
+				for (uint64_t k = 0; k < count; ++k) {
+					words[w++] ^= read_word(token + (header & LITERAL_FLAG ? k * sizeof(uint64_t) : 0));
+				}
+				token += (header & LITERAL_FLAG ? count : 1) * sizeof(uint64_t);
+			}
+			if (w != words.size()) {
+				throw std::runtime_error("Corrupt word run snapshot frame");
+			}
+			break;
+		}
+
+		case SnapshotEncoding::BitRuns: {
+			uint64_t position = 0;
+			for (const std::byte * byte = begin; byte < end; ) {
+				uint64_t run = 0;
+				for (size_t shift = 0; ; shift += 7) {
+					if (byte == end || shift >= 64) {
+						throw std::runtime_error("Corrupt bit run snapshot frame");
+					}
+					const auto value = static_cast<uint8_t>(*byte++);
+					run |= static_cast<uint64_t>(value & 0x7f) << shift;
+					if (!(value & 0x80)) break;
+				}
+				if (run >= sites - position) {
+					throw std::runtime_error("Corrupt bit run snapshot frame");
+				}
+				position += run;
+				words[position / 64] ^= static_cast<uint64_t>(1) << (position % 64);
+				position += 1;
+			}
+			break;
+		}
+
+		default:
+			throw std::runtime_error("Unknown snapshot frame encoding");
+	}
+}
+
+std::vector<int8_t> SnapshotReader::frame(const size_t frame) const {
+	assert(frame < index.size());
+	size_t keyframe = frame;
+	while (!index[keyframe].keyframe) {
+		if (keyframe == 0) {
+			throw std::runtime_error("Snapshot frames without a keyframe");
+		}
+		--keyframe;
+	}
+
+	std::vector<uint64_t> words ((sites + 63) / 64);
+	for (size_t k = keyframe; k <= frame; ++k) decode(index[k], words);
+
+	std::vector<int8_t> spins (sites);
+	for (size_t i = 0; i < sites; ++i) {
+		spins[i] = (words[i / 64] >> (i % 64)) & 1 ? 1 : -1;
+	}
+	return spins;
+}
@@ -0,0 +1,282 @@
+#include "time_series.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+/**
+ * Maps signed deltas onto unsigned integers so that small magnitudes of either sign need few bits.
+ */
+static uint64_t zigzag(const int64_t value) {
+	return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static int64_t unzigzag(const uint64_t value) {
+	return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+template<typename T>
+static void append_bytes(std::vector<uint8_t> & bytes, const T value) {
+	const auto raw = std::bit_cast<std::array<uint8_t, sizeof(T)>>(value);
+	bytes.insert(bytes.end(), raw.begin(), raw.end());
+}
+
+template<typename T>
+static T load_bytes(const std::vector<uint8_t> & bytes, const size_t offset) {
+	std::array<uint8_t, sizeof(T)> raw;
+	std::copy_n(bytes.begin() + static_cast<std::ptrdiff_t>(offset), sizeof(T), raw.begin());
+	return std::bit_cast<T>(raw);
+}
+
+void CompressedSeries::push_back(const int64_t value) {
+	pending.push_back(value);
+	count += 1;
+	if (pending.size() == BLOCK_SIZE) encode_block();
+}
+
+size_t CompressedSeries::size() const noexcept {
+	return count;
+}
+
+size_t CompressedSeries::compressed_bytes() const noexcept {
+	return blocks.size() + pending.size() * sizeof(int64_t);
+}
+
+/**
+ * A block consists of the first value, the bit width, the number of values and the packed deltas.
+ */
+void CompressedSeries::encode_block() {
+	uint64_t widest = 0;
+	for (size_t i = 1; i < pending.size(); ++i) {
+		widest |= zigzag(pending[i] - pending[i - 1]);
+	}
+	const auto width = static_cast<uint8_t>(std::bit_width(widest));
+
+	append_bytes(blocks, pending.front());
+	append_bytes(blocks, width);
+	append_bytes(blocks, static_cast<uint8_t>(pending.size()));
+
+	std::vector<uint64_t> words ((width * (pending.size() - 1) + 63) / 64, 0);
+	for (size_t i = 1, bit = 0; width > 0 && i < pending.size(); ++i, bit += width) {
+		const uint64_t delta = zigzag(pending[i] - pending[i - 1]);
+		words[bit / 64] |= delta << (bit % 64);
+		if (bit % 64 + width > 64) words[bit / 64 + 1] |= delta >> (64 - bit % 64);
+	}
+	for (const uint64_t word : words) append_bytes(blocks, word);
+
+	pending.clear();
+}
+
+size_t CompressedSeries::decode_block(size_t offset, std::vector<int64_t> & values) const {
+	const auto first = load_bytes<int64_t>(blocks, offset);
+	const auto width = load_bytes<uint8_t>(blocks, offset + sizeof(int64_t));
+	const auto size = load_bytes<uint8_t>(blocks, offset + sizeof(int64_t) + 1);
+	offset += sizeof(int64_t) + 2;
+
+	const uint64_t mask = width == 64 ? std::numeric_limits<uint64_t>::max() : (uint64_t { 1 } << width) - 1;
+	values.resize(size);
+	values.front() = first;
+	for (size_t i = 1, bit = 0; i < size; ++i, bit += width) {
+		uint64_t delta = 0;
+		if (width > 0) {
+			delta = load_bytes<uint64_t>(blocks, offset + bit / 64 * 8) >> (bit % 64);
+			if (bit % 64 + width > 64) delta |= load_bytes<uint64_t>(blocks, offset + (bit / 64 + 1) * 8) << (64 - bit % 64);
+		}
+		values[i] = values[i - 1] + unzigzag(delta & mask);
+	}
+	return offset + (width * (size - 1) + 63) / 64 * 8;
+}
+
+std::vector<int64_t> CompressedSeries::decode() const {
+	std::vector<int64_t> values, block;
+	values.reserve(count);
+	for (size_t offset = 0; offset < blocks.size();) {
+		offset = decode_block(offset, block);
+		values.insert(values.end(), block.begin(), block.end());
+	}
+	values.insert(values.end(), pending.begin(), pending.end());
+	return values;
+}
+
+std::vector<SeriesBucket> CompressedSeries::downsample(size_t buckets) const {
+	assert(buckets > 0);
+	buckets = std::min(buckets, count);
+
+	std::vector<SeriesBucket> result;
+	std::vector<size_t> sizes;
+
+	size_t index = 0;
+	const auto add = [&] (const int64_t value) {
+		const size_t bucket = index++ * buckets / count;
+		if (bucket == result.size()) {
+			result.push_back({ value, value, 0.0 });
+			sizes.push_back(0);
+		}
+		result.back().min = std::min(result.back().min, value);
+		result.back().max = std::max(result.back().max, value);
+		result.back().mean += static_cast<double>(value);
+		sizes.back() += 1;
+	};
+
+	std::vector<int64_t> block;
+	for (size_t offset = 0; offset < blocks.size();) {
+		offset = decode_block(offset, block);
+		std::ranges::for_each(block, add);
+	}
+	std::ranges::for_each(pending, add);
+
+	for (size_t i = 0; i < result.size(); ++i) {
+		result[i].mean /= static_cast<double>(sizes[i]);
+	}
+	return result;
+}
+
+void CompressedSeries::write(std::ostream & os) const {
+	const uint64_t sizes[] { count, blocks.size(), pending.size() };
+	os.write(reinterpret_cast<const char *>(sizes), sizeof(sizes));
+	os.write(reinterpret_cast<const char *>(blocks.data()), static_cast<std::streamsize>(blocks.size()));
+	os.write(reinterpret_cast<const char *>(pending.data()), static_cast<std::streamsize>(pending.size() * sizeof(int64_t)));
+}
+
+/**
+ * The sizes are cross-checked before anything is allocated: every block holds BLOCK_SIZE values and takes between
+ * BLOCK_HEADER_BYTES and MAX_BLOCK_BYTES bytes. The blocks are read in chunks, so a truncated stream fails before a
+ * corrupt size can allocate more than the stream holds, and every block header is checked before decode trusts it.
+ */
+CompressedSeries CompressedSeries::read(std::istream & is) {
+	constexpr size_t BLOCK_HEADER_BYTES = sizeof(int64_t) + 2, MAX_BLOCK_BYTES = BLOCK_HEADER_BYTES + (BLOCK_SIZE - 1) * sizeof(uint64_t);
+	constexpr size_t CHUNK_BYTES = 1 << 20;
+
+	uint64_t sizes[3];
+	CompressedSeries series;
+	if (!is.read(reinterpret_cast<char *>(sizes), sizeof(sizes))) {
+		throw std::runtime_error("Truncated compressed series");
+	}
+	if (sizes[2] >= BLOCK_SIZE || sizes[0] < sizes[2] || (sizes[0] - sizes[2]) % BLOCK_SIZE != 0) {
+		throw std::runtime_error("Corrupt compressed series");
+	}
+	const uint64_t num_blocks = (sizes[0] - sizes[2]) / BLOCK_SIZE;
+	if (num_blocks > sizes[1] / BLOCK_HEADER_BYTES || sizes[1] / MAX_BLOCK_BYTES > num_blocks) {
+		throw std::runtime_error("Corrupt compressed series");
+	}
+	series.count = sizes[0];
+
+	while (series.blocks.size() < sizes[1]) {
+		const size_t offset = series.blocks.size();
+		series.blocks.resize(offset + std::min<uint64_t>(CHUNK_BYTES, sizes[1] - offset));
+		if (!is.read(reinterpret_cast<char *>(series.blocks.data() + offset), static_cast<std::streamsize>(series.blocks.size() - offset))) {
+			throw std::runtime_error("Truncated compressed series");
+		}
+	}
+	series.pending.resize(sizes[2]);
+	if (!is.read(reinterpret_cast<char *>(series.pending.data()), static_cast<std::streamsize>(series.pending.size() * sizeof(int64_t)))) {
+		throw std::runtime_error("Truncated compressed series");
+	}
+
+	uint64_t blocks_found = 0;
+	for (size_t offset = 0; offset < series.blocks.size(); blocks_found += 1) {
+		if (series.blocks.size() - offset < BLOCK_HEADER_BYTES) {
+			throw std::runtime_error("Corrupt compressed series");
+		}
+		const auto width = load_bytes<uint8_t>(series.blocks, offset + sizeof(int64_t));
+		const auto size = load_bytes<uint8_t>(series.blocks, offset + sizeof(int64_t) + 1);
+		const size_t payload = (width * (size - 1) + 63) / 64 * 8;
+		if (width > 64 || size != BLOCK_SIZE || series.blocks.size() - offset - BLOCK_HEADER_BYTES < payload) {
+			throw std::runtime_error("Corrupt compressed series");
+		}
+		offset += BLOCK_HEADER_BYTES + payload;
+	}
+	if (blocks_found != num_blocks) {
+		throw std::runtime_error("Corrupt compressed series");
+	}
+	return series;
+}
+
+ObservableHistory::ObservableHistory(const double j, const size_t num_sites) : j(j), num_sites(num_sites) {
+	assert(j != 0.0);
+}
+
+void ObservableHistory::push(const LatticeObservable & observable) {
+	if (bonds.size() == 0) first_sweep = observable.sweeps;
+	assert(observable.sweeps == first_sweep + bonds.size());
+
+	const auto sites = static_cast<double>(num_sites);
+	bonds.push_back(std::llround(-observable.energy * sites / j));
+	spins.push_back(std::llround(observable.magnetization * sites));
+}
+
+size_t ObservableHistory::size() const noexcept {
+	return bonds.size();
+}
+
+size_t ObservableHistory::compressed_bytes() const noexcept {
+	return bonds.compressed_bytes() + spins.compressed_bytes();
+}
+
+std::vector<LatticeObservable> ObservableHistory::decode() const {
+	const auto sites = static_cast<double>(num_sites);
+	const std::vector<int64_t> bond_sums = bonds.decode(), spin_sums = spins.decode();
+
+	std::vector<LatticeObservable> history;
+	history.reserve(bond_sums.size());
+	for (size_t i = 0; i < bond_sums.size(); ++i) {
+		history.emplace_back(first_sweep + i, j, -j * static_cast<double>(bond_sums[i]) / sites, static_cast<double>(spin_sums[i]) / sites);
+	}
+	return history;
+}
+
+std::vector<HistoryBucket> ObservableHistory::downsample(const size_t buckets) const {
+	const auto sites = static_cast<double>(num_sites);
+	const std::vector<SeriesBucket> bond_buckets = bonds.downsample(buckets), spin_buckets = spins.downsample(buckets);
+
+	std::vector<HistoryBucket> result (bond_buckets.size());
+	for (size_t i = 0; i < result.size(); ++i) {
+		const auto [energy_min, energy_max] = std::minmax({ -j * static_cast<double>(bond_buckets[i].min) / sites, -j * static_cast<double>(bond_buckets[i].max) / sites });
+		result[i] = HistoryBucket {
+			first_sweep + (i * size() + result.size() - 1) / result.size(),
+			energy_min, energy_max, -j * bond_buckets[i].mean / sites,
+			static_cast<double>(spin_buckets[i].min) / sites, static_cast<double>(spin_buckets[i].max) / sites, spin_buckets[i].mean / sites
+		};
+	}
+	return result;
+}
+
+void ObservableHistory::write(const std::string & file_name) const {
+	std::ofstream output ("output/" + file_name + ".ts", std::ios::binary);
+	const uint64_t header[] { num_sites, first_sweep };
+	output.write(reinterpret_cast<const char *>(&j), sizeof(j));
+	output.write(reinterpret_cast<const char *>(header), sizeof(header));
+	bonds.write(output);
+	spins.write(output);
+}
+
+ObservableHistory ObservableHistory::read(const std::string & file_name) {
+	const std::string path = "output/" + file_name + ".ts";
+	std::ifstream input (path, std::ios::binary);
+	if (!input) {
+		throw std::runtime_error("Cannot open time series file " + path);
+	}
+
+	double j;
+	uint64_t header[2];
+	if (!input.read(reinterpret_cast<char *>(&j), sizeof(j))) {
+		throw std::runtime_error("Truncated time series file " + path);
+	}
+	if (!input.read(reinterpret_cast<char *>(header), sizeof(header))) {
+		throw std::runtime_error("Truncated time series file " + path);
+	}
+	if (j == 0.0 || header[0] == 0) {
+		throw std::runtime_error("Corrupt time series file " + path);
+	}
+
+	ObservableHistory history { j, header[0] };
+	history.first_sweep = header[1];
+	history.bonds = CompressedSeries::read(input);
+	history.spins = CompressedSeries::read(input);
+	return history;
+}
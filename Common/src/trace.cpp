@@ -0,0 +1,143 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+/**
+ * A completed span with its begin and end in nanoseconds since tracing was enabled.
+ */
+struct TraceEvent {
+	std::string_view name;
+	std::array<TraceSpan::Argument, TraceSpan::MAX_ARGUMENTS> arguments;
+	uint8_t num_arguments;
+	int64_t begin, end;
+};
+
+/**
+ * The events of a single thread. The buffers are shared with the registry so they outlive their threads.
+ */
+struct TraceBuffer {
+	size_t thread;
+	std::vector<TraceEvent> events;
+	size_t dropped = 0;
+};
+
+static std::chrono::steady_clock::time_point epoch;
+
+static std::string output_name;
+
+/**
+ * The buffers of all threads which recorded at least one span. Only locked once per thread on its first span.
+ */
+static std::mutex buffers_mtx;
+
+static std::vector<std::shared_ptr<TraceBuffer>> & buffers() {
+	static std::vector<std::shared_ptr<TraceBuffer>> instance;
+	return instance;
+}
+
+/**
+ * Returns the buffer of the calling thread. The events are reserved up front when the first span of the thread begins,
+ * so ending a span never allocates.
+ */
+static TraceBuffer & thread_buffer() {
+	thread_local const std::shared_ptr<TraceBuffer> buffer = [] {
+		auto created = std::make_shared<TraceBuffer>(TraceBuffer { 0, {} });
+		created->events.reserve(TraceSpan::MAX_EVENTS);
+
+		std::lock_guard buffers_lock (buffers_mtx);
+		created->thread = buffers().size();
+		buffers().push_back(created);
+		return created;
+	}();
+	return *buffer;
+}
+
+static int64_t now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+/**
+ * Writes the value as a JSON number, or as a string if it is not finite since JSON has no literals for NaN and
+ * infinities. The bits are inspected directly because the library is compiled with -Ofast, under which std::isnan and
+ * std::isinf may be folded to false.
+ */
+static void write_value(std::ostream & output, const double value) {
+	constexpr uint64_t EXPONENT = 0x7FF0000000000000, MANTISSA = 0x000FFFFFFFFFFFFF;
+	const uint64_t bits = std::bit_cast<uint64_t>(value);
+	if ((bits & EXPONENT) != EXPONENT) {
+		output << std::defaultfloat << std::setprecision(10) << value << std::fixed << std::setprecision(3);
+	} else if ((bits & MANTISSA) != 0) {
+		output << "\"nan\"";
+	} else {
+		output << (std::signbit(value) ? "\"-inf\"" : "\"inf\"");
+	}
+}
+
+void TraceSpan::begin_span(const std::string_view name, const Arguments arguments) {
+	static_cast<void>(thread_buffer());
+	this->name = name;
+	num_arguments = static_cast<uint8_t>(std::min(arguments.size(), MAX_ARGUMENTS));
+	std::copy_n(arguments.begin(), num_arguments, this->arguments.begin());
+	begin = now();
+}
+
+void TraceSpan::end_span() noexcept {
+	const int64_t end = now();
+	TraceBuffer & buffer = thread_buffer();
+	if (buffer.events.size() == MAX_EVENTS) {
+		buffer.dropped += 1;
+		return;
+	}
+	buffer.events.push_back({ name, arguments, num_arguments, begin, end });
+}
+
+void TraceSpan::enable(const std::string & file_name) {
+	static_cast<void>(buffers());
+	epoch = std::chrono::steady_clock::now();
+	output_name = file_name;
+
+	if (!recording.exchange(true)) {
+		std::atexit([] { write(output_name); });
+	}
+}
+
+void TraceSpan::write(const std::string & file_name) {
+	std::ofstream output;
+	output.open("output/" + file_name + ".json");
+	output << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n";
+
+	std::lock_guard buffers_lock (buffers_mtx);
+	bool first = true;
+	for (const std::shared_ptr<TraceBuffer> & buffer : buffers()) {
+		output << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread << ",\"args\":{\"name\":\"thread " << buffer->thread << "\"}}";
+		first = false;
+
+		for (const TraceEvent & event : buffer->events) {
+			output << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread
+				<< ",\"ts\":" << static_cast<double>(event.begin) / 1000.0 << ",\"dur\":" << static_cast<double>(event.end - event.begin) / 1000.0
+				<< ",\"args\":{";
+			for (size_t i = 0; i < event.num_arguments; ++i) {
+				output << (i > 0 ? "," : "") << "\"" << event.arguments[i].key << "\":";
+				write_value(output, event.arguments[i].value);
+			}
+			output << "}}";
+		}
+
+		if (buffer->dropped > 0) {
+			output << ",\n{\"name\":\"dropped_events\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":" << buffer->thread
+				<< ",\"ts\":" << static_cast<double>(buffer->events.back().end) / 1000.0 << ",\"args\":{\"count\":" << buffer->dropped << "}}";
+		}
+	}
+	output << "\n]}\n";
+	output.close();
+}